@@ -0,0 +1,375 @@
+// Headless benchmark for the Application::Update() -> Window::Update() path.
+// Runs a set of synthetic scenarios for a fixed number of frames and writes JSON,
+// so runs from different versions can be diffed.
+//
+//   imgui_desktop_bench [--frames N] [--warmup N] [--scenario NAME] [--output FILE]
+
+#include <imgui_desktop/Allocation.h>
+#include <imgui_desktop/Application.h>
+#include <imgui_desktop/Window.h>
+
+#include <imgui.h>
+#include <SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace ImGuiDesktop;
+
+static std::atomic<uint64_t> s_AllocationCount = 0;
+
+// Aligned new isn't replaced, nothing on this path uses over-aligned types
+void* operator new(size_t size)
+{
+	s_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace
+{
+	// operator new, plus whatever imgui allocated
+	uint64_t GetAllocationCount()
+	{
+		return s_AllocationCount.load(std::memory_order_relaxed) + GetImGuiAllocationTotals().m_Count;
+	}
+
+	struct Options
+	{
+		uint32_t m_Frames = 300;
+		uint32_t m_WarmupFrames = 30;
+		const char* m_Scenario = nullptr;
+		const char* m_OutputFile = nullptr;
+	};
+
+	struct ScenarioCounters
+	{
+		uint64_t m_DrawCalls = 0;
+		uint64_t m_MergedDrawCalls = 0;
+		uint64_t m_UploadBytes = 0;
+	};
+
+	using DrawFunc = std::function<void(uint64_t frame)>;
+
+	class BenchWindow final : public Window
+	{
+	public:
+		BenchWindow(Application& app, ScenarioCounters& counters, DrawFunc drawFunc, const char* title = "Benchmark") :
+			Window(app, 1280, 720, title),
+			m_Counters(&counters),
+			m_DrawFunc(std::move(drawFunc))
+		{
+		}
+
+	protected:
+		void OnDraw() override
+		{
+			m_DrawFunc(m_Frame++);
+		}
+
+		void OnEndFrame() override
+		{
+			const ImDrawData* drawData = ImGui::GetDrawData();
+			for (int i = 0; i < drawData->CmdListsCount; i++)
+			{
+				for (const ImDrawCmd& cmd : drawData->CmdLists[i]->CmdBuffer)
+				{
+					if (!cmd.UserCallback)
+						m_Counters->m_DrawCalls++;
+				}
+			}
+
+			// This frame's sample is only pushed after OnEndFrame(), so this is one frame behind
+			const FrameTimingHistory& timings = GetFrameTimings();
+			if (const size_t count = timings.GetSampleCount())
+			{
+				const RenderStats& stats = timings.GetSample(count - 1).m_RenderStats;
+				m_Counters->m_MergedDrawCalls += stats.m_DrawCalls;
+				m_Counters->m_UploadBytes += stats.m_UploadBytes;
+			}
+		}
+
+		// Every window draws (and renders) every frame, the point is to measure the full path
+		bool IsSleepingEnabled() const override { return false; }
+		bool CanSkipIdenticalFrames() const override { return false; }
+
+	private:
+		ScenarioCounters* m_Counters;
+		DrawFunc m_DrawFunc;
+		uint64_t m_Frame = 0;
+	};
+
+	void DrawSimpleWidgets(uint64_t frame)
+	{
+		ImGui::Text("Frame %llu", (unsigned long long)frame);
+		ImGui::Button("Button");
+		ImGui::ProgressBar(float(frame % 100) / 100);
+		for (int i = 0; i < 20; i++)
+			ImGui::Text("Line %d: %f", i, std::sin(double(frame + i) * 0.1));
+	}
+
+	DrawFunc MakeTable(int rowCount)
+	{
+		return [rowCount](uint64_t frame)
+		{
+			if (!ImGui::BeginTable("table", 4, ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+				return;
+
+			ImGui::TableSetupScrollFreeze(0, 1);
+
+			// Keep scrolling, so the visible rows change every frame
+			ImGui::SetScrollY(float(frame * 7 % uint64_t(rowCount)) * ImGui::GetTextLineHeightWithSpacing());
+
+			ImGuiListClipper clipper;
+			clipper.Begin(rowCount);
+			while (clipper.Step())
+			{
+				for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+				{
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", row);
+					ImGui::TableNextColumn();
+					ImGui::Text("Row %d name", row);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", row * 0.001);
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted((row + frame) % 2 ? "odd" : "even");
+				}
+			}
+
+			ImGui::EndTable();
+		};
+	}
+
+	void DrawTextHeavy(uint64_t frame)
+	{
+		static constexpr const char LOREM[] =
+			"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore "
+			"et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut.";
+
+		for (int i = 0; i < 500; i++)
+			ImGui::Text("%04d %llu %s", i, (unsigned long long)frame, LOREM);
+	}
+
+	struct Scenario
+	{
+		const char* m_Name;
+		// Sets up the application, and returns a function to call before every frame (or nullptr)
+		std::function<std::function<void(uint64_t)>(Application&, ScenarioCounters&)> m_Setup;
+	};
+
+	Scenario MakeWindowsScenario(const char* name, int windowCount)
+	{
+		return { name, [windowCount](Application& app, ScenarioCounters& counters)
+			{
+				for (int i = 0; i < windowCount; i++)
+					app.AddManagedWindow(std::make_unique<BenchWindow>(app, counters, &DrawSimpleWidgets));
+
+				return std::function<void(uint64_t)>{};
+			} };
+	}
+
+	Scenario MakeSingleWindowScenario(const char* name, DrawFunc drawFunc)
+	{
+		return { name, [drawFunc](Application& app, ScenarioCounters& counters)
+			{
+				app.AddManagedWindow(std::make_unique<BenchWindow>(app, counters, drawFunc));
+				return std::function<void(uint64_t)>{};
+			} };
+	}
+
+	Scenario MakeChurnScenario(const char* name, size_t liveWindows)
+	{
+		return { name, [liveWindows](Application& app, ScenarioCounters& counters)
+			{
+				auto windows = std::make_shared<std::deque<Window*>>();
+				return std::function<void(uint64_t)>([app = &app, counters = &counters, windows, liveWindows](uint64_t)
+					{
+						// Closed managed windows are destroyed at the end of Application::Update()
+						if (windows->size() >= liveWindows)
+						{
+							windows->front()->SetShouldClose();
+							windows->pop_front();
+						}
+
+						auto window = std::make_unique<BenchWindow>(*app, *counters, &DrawSimpleWidgets);
+						windows->push_back(window.get());
+						app->AddManagedWindow(std::move(window));
+					});
+			} };
+	}
+
+	struct Percentiles
+	{
+		double m_Min, m_Avg, m_P50, m_P95, m_P99, m_Max;
+	};
+
+	Percentiles GetPercentiles(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+
+		const auto GetPercentile = [&](double percentile)
+		{
+			const auto rank = size_t(std::ceil(percentile / 100 * double(values.size())));
+			return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+		};
+
+		double sum = 0;
+		for (double value : values)
+			sum += value;
+
+		return { values.front(), sum / double(values.size()), GetPercentile(50), GetPercentile(95), GetPercentile(99), values.back() };
+	}
+
+	void RunScenario(const Scenario& scenario, const Options& options, FILE* out, bool isFirst)
+	{
+		using clock = std::chrono::steady_clock;
+
+		Application app;
+		app.SetHeadless(true);
+		app.SetPresentPolicy(PresentPolicy::Immediate);
+
+		ScenarioCounters counters;
+		const auto beforeFrame = scenario.m_Setup(app, counters);
+
+		std::vector<double> frameTimes;
+		frameTimes.reserve(options.m_Frames);
+
+		uint64_t allocations = 0;
+		uint64_t drawCalls = 0;
+		uint64_t mergedDrawCalls = 0;
+		uint64_t uploadBytes = 0;
+		clock::duration totalTime{};
+
+		for (uint32_t frame = 0; frame < options.m_WarmupFrames + options.m_Frames; frame++)
+		{
+			const bool isMeasured = frame >= options.m_WarmupFrames;
+
+			const auto allocsStart = GetAllocationCount();
+			const auto drawCallsStart = counters.m_DrawCalls;
+			const auto mergedDrawCallsStart = counters.m_MergedDrawCalls;
+			const auto uploadBytesStart = counters.m_UploadBytes;
+			const auto frameStart = clock::now();
+
+			if (beforeFrame)
+				beforeFrame(frame);
+
+			app.Update();
+
+			const auto frameTime = clock::now() - frameStart;
+
+			if (isMeasured)
+			{
+				allocations += GetAllocationCount() - allocsStart;
+				drawCalls += counters.m_DrawCalls - drawCallsStart;
+				mergedDrawCalls += counters.m_MergedDrawCalls - mergedDrawCallsStart;
+				uploadBytes += counters.m_UploadBytes - uploadBytesStart;
+				totalTime += frameTime;
+				frameTimes.push_back(std::chrono::duration<double, std::milli>(frameTime).count());
+			}
+		}
+
+		const auto frameMS = GetPercentiles(frameTimes);
+		const double seconds = std::chrono::duration<double>(totalTime).count();
+
+		std::fprintf(out, "%s\n\t\t{\n", isFirst ? "" : ",");
+		std::fprintf(out, "\t\t\t\"name\": \"%s\",\n", scenario.m_Name);
+		std::fprintf(out, "\t\t\t\"frames\": %u,\n", options.m_Frames);
+		std::fprintf(out, "\t\t\t\"fps\": %.3f,\n", seconds > 0 ? options.m_Frames / seconds : 0);
+		std::fprintf(out, "\t\t\t\"frame_ms\": { \"min\": %.4f, \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+			frameMS.m_Min, frameMS.m_Avg, frameMS.m_P50, frameMS.m_P95, frameMS.m_P99, frameMS.m_Max);
+		std::fprintf(out, "\t\t\t\"allocations_per_frame\": %.2f,\n", double(allocations) / options.m_Frames);
+		std::fprintf(out, "\t\t\t\"draw_calls_per_frame\": %.2f,\n", double(drawCalls) / options.m_Frames);
+		std::fprintf(out, "\t\t\t\"merged_draw_calls_per_frame\": %.2f,\n", double(mergedDrawCalls) / options.m_Frames);
+		std::fprintf(out, "\t\t\t\"upload_bytes_per_frame\": %.0f\n", double(uploadBytes) / options.m_Frames);
+		std::fprintf(out, "\t\t}");
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			const auto HasValue = [&] { return i + 1 < argc; };
+
+			if (!std::strcmp(argv[i], "--frames") && HasValue())
+				options.m_Frames = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+			else if (!std::strcmp(argv[i], "--warmup") && HasValue())
+				options.m_WarmupFrames = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+			else if (!std::strcmp(argv[i], "--scenario") && HasValue())
+				options.m_Scenario = argv[++i];
+			else if (!std::strcmp(argv[i], "--output") && HasValue())
+				options.m_OutputFile = argv[++i];
+			else
+				return false;
+		}
+
+		return options.m_Frames > 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::fprintf(stderr, "Usage: %s [--frames N] [--warmup N] [--scenario NAME] [--output FILE]\n", argv[0]);
+		return 1;
+	}
+
+	const Scenario scenarios[] =
+	{
+		MakeWindowsScenario("windows_1", 1),
+		MakeWindowsScenario("windows_8", 8),
+		MakeWindowsScenario("windows_64", 64),
+		MakeSingleWindowScenario("table_10k_rows", MakeTable(10'000)),
+		MakeSingleWindowScenario("table_100k_rows", MakeTable(100'000)),
+		MakeSingleWindowScenario("text_heavy", &DrawTextHeavy),
+		MakeChurnScenario("managed_window_churn", 4),
+	};
+
+	FILE* out = stdout;
+	if (options.m_OutputFile && !(out = std::fopen(options.m_OutputFile, "w")))
+	{
+		std::fprintf(stderr, "Failed to open %s for writing\n", options.m_OutputFile);
+		return 1;
+	}
+
+	std::fprintf(out, "{\n\t\"scenarios\": [");
+
+	bool isFirst = true;
+	for (const Scenario& scenario : scenarios)
+	{
+		if (options.m_Scenario && std::strcmp(options.m_Scenario, scenario.m_Name))
+			continue;
+
+		RunScenario(scenario, options, out, isFirst);
+		isFirst = false;
+	}
+
+	std::fprintf(out, "\n\t]\n}\n");
+
+	if (out != stdout)
+		std::fclose(out);
+
+	SDL_Quit();
+	return 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace ImGuiDesktop
+{
+	struct AllocationStats
+	{
+		uint64_t m_Count = 0;
+		uint64_t m_Bytes = 0;
+	};
+
+	// Everything imgui has allocated so far, across all windows and threads. imgui's allocator
+	// functions are replaced by the first Window, so anything set with ImGui::SetAllocatorFunctions()
+	// before that is overridden.
+	AllocationStats GetImGuiAllocationTotals();
+
+	// Bump allocator for data that only has to live until the end of the frame. Grows until
+	// it's big enough for a whole frame, after that allocating from it never touches the heap.
+	// Nothing is ever freed individually and no destructors run, everything is thrown away by Reset().
+	class FrameArena final : public std::pmr::memory_resource, mh::disable_copy_move
+	{
+	public:
+		FrameArena() = default;
+		~FrameArena();
+
+		template<typename T, typename... TArgs>
+		T* New(TArgs&&... args)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "Destructors are never called for objects in a FrameArena");
+			return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<TArgs>(args)...);
+		}
+
+		// Null terminated copy
+		std::string_view CopyString(const std::string_view& str);
+
+		void Reset();
+
+		size_t GetBytesUsed() const { return m_BytesUsed; }
+		size_t GetCapacity() const;
+
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void*, size_t, size_t) override {}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+	private:
+		static constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+		struct Chunk
+		{
+			std::unique_ptr<std::byte[]> m_Data;
+			size_t m_Size = 0;
+		};
+
+		std::vector<Chunk> m_Chunks;
+		size_t m_CurrentChunk = 0;
+		size_t m_Offset = 0;
+		size_t m_BytesUsed = 0;
+	};
+}
@@ -1,14 +1,33 @@
 #pragma once
 
+#include "GLContextVersion.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 struct ImFontAtlas;
 struct SDL_Window;
+union SDL_Event;
 
 namespace ImGuiDesktop
 {
 	class GLContext;
+	class GLContextScope;
+	class GLWorkerPool;
+	class Renderer;
+	class StartupJobs;
+	class TaskQueue;
+	class TextureManager;
+	class ThreadPool;
 	class Window;
 
 	class IApplicationWindowInterface
@@ -22,6 +41,64 @@ namespace ImGuiDesktop
 		virtual void RemoveWindow(Window* window) = 0;
 
 		virtual std::shared_ptr<GLContext> GetOrCreateGLContext(SDL_Window* window) = 0;
+		// Returns a generation that changes whenever the atlas is (re)built
+		virtual uint64_t EnsureFontAtlasBuilt() = 0;
+
+		// Startup jobs run from the start of the first window's constructor until its first frame
+		virtual void StartStartupJobs() = 0;
+		virtual void JoinStartupJobs() = 0;
+		virtual void AddStartupPhase(const char* name, std::chrono::steady_clock::time_point start) = 0;
+
+		// Doesn't wait for the startup jobs, only for handing to ImGui::CreateContext()
+		virtual ImFontAtlas& GetSharedFontAtlas() = 0;
+
+		// ImGui::NewFrame()/EndFrame() for the current context. Both write the shared atlas's Locked flag,
+		// so they are serialized, and the atlas stays locked until the last frame being built has ended.
+		virtual void NewImGuiFrame() = 0;
+		virtual void EndImGuiFrame() = 0;
+		// Instead of EndImGuiFrame(), for a frame that threw
+		virtual void AbandonImGuiFrame() = 0;
+
+		// Shared GL context must be current. Lives as long as any window holds on to it.
+		virtual std::shared_ptr<Renderer> GetOrCreateRenderer(const GLContextScope& scope) = 0;
+	};
+
+	enum class PresentPolicy
+	{
+		VSyncAll,      // Every window waits for vsync when swapping. With N visible windows the frame rate drops to refresh/N.
+		PacingWindow,  // Only the pacing window waits for vsync, everything else presents immediately (or with adaptive vsync).
+		Immediate,     // Nothing waits for vsync. Use SetFrameRateCap() to keep this from spinning.
+	};
+
+	struct WakeupStats
+	{
+		uint64_t m_RequestCount = 0;   // Calls to QueueUpdate(), plus background GL work waking up the loop
+		uint64_t m_CoalescedCount = 0; // Calls that piggybacked on an already pending wakeup
+	};
+
+	struct GLContextSwitchStats
+	{
+		uint64_t m_SwitchCount = 0;  // Calls to SDL_GL_MakeCurrent
+		uint64_t m_SkippedCount = 0; // Scopes entered with the right window and context already bound
+	};
+
+	struct GLContextProbeSettings
+	{
+		// Tried in order until one works. 3.2 and up are requested as core profiles.
+		std::vector<GLContextVersion> m_Versions{ GLContextVersion(4, 3), GLContextVersion(3, 2), GLContextVersion(2, 0) };
+
+		// Remembers which version worked with the current driver, so later launches skip the ones that
+		// fail. Falls back to probing everything if the driver changed or that version stops working.
+		// Empty (the default) disables the cache.
+		std::filesystem::path m_CachePath;
+	};
+
+	struct StartupTimelineEntry
+	{
+		std::string m_Name;
+		std::chrono::steady_clock::duration m_Start{};    // Relative to the construction of the Application
+		std::chrono::steady_clock::duration m_Duration{};
+		bool m_IsBackground = false;                       // Ran on the startup worker thread
 	};
 
 	class Application : public IApplicationWindowInterface
@@ -31,11 +108,97 @@ namespace ImGuiDesktop
 		~Application();
 
 		void Update();
+
+		// Wakes up the main loop and redraws the given window, or every window if nullptr.
+		// Safe to call from any thread. At most one wakeup event is in flight at a time,
+		// any requests made while one is pending are coalesced into it.
 		void QueueUpdate(Window* window);
+		WakeupStats GetWakeupStats() const;
+
+		// Process-wide, across all threads
+		GLContextSwitchStats GetGLContextSwitchStats() const;
+
+		// Runs the task on the main thread before the next frame is drawn, then redraws
+		// every window. Safe to call from any thread, posting never takes a lock.
+		void Post(std::function<void()> task);
+
+		// Runs job on a worker thread with a GL context that shares objects (textures, buffers, programs)
+		// with the windows, then onComplete on the main thread, at the start of an Update(), once the GPU
+		// has finished every command the job issued. Anything the job creates must not be used before then.
+		// Container objects (VAOs, FBOs) are never shared, create those in onComplete. Safe to call from any
+		// thread. Exceptions thrown by the job are rethrown from Update(), and its onComplete is skipped.
+		// Every window is redrawn after an onComplete.
+		void PostGLJob(std::function<void()> job, std::function<void()> onComplete = nullptr);
+		// Same, with whatever the job returned (texture names etc) handed to onComplete
+		template<typename TJob, typename TOnComplete>
+		void PostGLJob(TJob job, TOnComplete onComplete);
+
+		// Number of GL worker threads, each with its own hidden window and context. Takes effect when the
+		// first GL job is started, which happens once the first window exists.
+		void SetGLWorkerCount(size_t count) { m_GLWorkerCount = count; }
+		size_t GetGLWorkerCount() const { return m_GLWorkerCount; }
 
 		bool ShouldQuit() const;
 
-		ImFontAtlas& GetFontAtlas() const { return *m_SharedFontAtlas.get(); }
+		// Render every window into an offscreen framebuffer instead of presenting it. Must be set before
+		// the first window is created. Selects SDL's "offscreen" video driver unless SDL_VIDEODRIVER is
+		// already set, so with Mesa (llvmpipe) this runs on machines without a GPU or display server.
+		// Windows created while running on the "offscreen" or "dummy" drivers are always headless.
+		void SetHeadless(bool headless) { m_IsHeadless = headless; }
+		bool IsHeadless() const { return m_IsHeadless; }
+
+		void SetPresentPolicy(PresentPolicy policy) { m_PresentPolicy = policy; }
+		PresentPolicy GetPresentPolicy() const { return m_PresentPolicy; }
+
+		// Window that should wait for vsync under PresentPolicy::PacingWindow. If nullptr (or the
+		// window isn't drawing this frame), the focused window or the first visible one is used.
+		void SetPacingWindow(Window* window) { m_PacingWindow = window; }
+		// The window that actually waited for vsync in the last frame, if any
+		Window* GetActivePacingWindow() const { return m_ActivePacingWindow; }
+
+		// Under PresentPolicy::PacingWindow, present the non-pacing windows with adaptive
+		// vsync (swap interval -1) instead of immediately, where the driver supports it.
+		void SetAdaptiveVSyncEnabled(bool enabled) { m_AdaptiveVSyncEnabled = enabled; }
+		bool IsAdaptiveVSyncEnabled() const { return m_AdaptiveVSyncEnabled; }
+
+		// Upper limit on how often the main loop draws frames, regardless of vsync. 0 disables the cap.
+		void SetFrameRateCap(float fps);
+		float GetFrameRateCap() const;
+
+		// Runs the CPU side of every due window's frame (ImGui::NewFrame(), OnDraw(), ImGui::Render()) in parallel
+		// on a thread pool. Events, OnUpdate(), OnPreDraw(), GL submission and presenting stay on the main thread.
+		// OnDraw() for different windows may then run at the same time, and without a current GL context.
+		// Requires building with IMGUI_DESKTOP_THREAD_LOCAL_CONTEXT, and imgui itself with imgui_desktop/ImGuiHelpers.h
+		// as its IMGUI_USER_CONFIG. That is checked at runtime, and this is ignored if either is missing.
+		void SetParallelFrameBuildingEnabled(bool enabled);
+		bool IsParallelFrameBuildingEnabled() const { return m_IsParallelFrameBuildingEnabled; }
+
+		// Only affects the shared GL context, which is created along with the first window
+		void SetGLContextProbeSettings(GLContextProbeSettings settings) { m_GLContextProbeSettings = std::move(settings); }
+		const GLContextProbeSettings& GetGLContextProbeSettings() const { return m_GLContextProbeSettings; }
+
+		// Waits for the startup jobs if they are still building the atlas. Fonts added later are built
+		// before the next frame, don't Build() it directly or the renderer won't notice.
+		ImFontAtlas& GetFontAtlas() const;
+
+		// Runs the job on a worker thread while the first window initializes SDL and OpenGL. Everything
+		// is joined right before that window's first frame (before OnOpenGLInit()/OnImGuiInit()).
+		// Jobs added after the first window was created run immediately on the calling thread.
+		// The font atlas is built the same way, so add fonts before creating the first window.
+		void AddStartupJob(std::string name, std::function<void()> job);
+
+		// How long each part of startup took, in order of when it started. Background jobs show
+		// up once they have been joined. Complete after the first call to Update() that drew a frame.
+		const std::vector<StartupTimelineEntry>& GetStartupTimeline() const { return m_StartupTimeline; }
+
+		// File the baked font atlas is loaded from/saved to, skipping the glyph rasterization on startup.
+		// The cache is rebuilt automatically whenever the fonts, sizes, glyph ranges or oversampling
+		// settings change. Empty (the default) disables the cache.
+		void SetFontAtlasCachePath(std::filesystem::path path) { m_FontAtlasCachePath = std::move(path); }
+		const std::filesystem::path& GetFontAtlasCachePath() const { return m_FontAtlasCachePath; }
+
+		// Textures for ImGui::Image(), shared by every window. Safe to use from any thread.
+		TextureManager& GetTextureManager() const { return *m_TextureManager; }
 
 		void AddManagedWindow(std::unique_ptr<Window> window);
 
@@ -51,13 +214,85 @@ namespace ImGuiDesktop
 		void RemoveWindow(Window* window) override final;
 
 		std::shared_ptr<GLContext> GetOrCreateGLContext(SDL_Window* window) override final;
+		uint64_t EnsureFontAtlasBuilt() override final;
+		void StartStartupJobs() override final;
+		void JoinStartupJobs() override final;
+		void AddStartupPhase(const char* name, std::chrono::steady_clock::time_point start) override final;
+		ImFontAtlas& GetSharedFontAtlas() override final { return *m_SharedFontAtlas; }
+		void NewImGuiFrame() override final;
+		void EndImGuiFrame() override final;
+		void AbandonImGuiFrame() override final;
+		std::shared_ptr<Renderer> GetOrCreateRenderer(const GLContextScope& scope) override final;
+		void BuildFontAtlas();
+
+		Window* FindWindow(uint32_t windowID) const;
+		void DrainPostedTasks();
+		void QueueWakeup(); // Only runs the loop, without redrawing any window
+		void ProcessTextureUploads(std::chrono::steady_clock::time_point now);
+		bool DispatchEvent(const SDL_Event& event);
+		void ConsumeQueuedUpdates();
+		Window* ChoosePacingWindow(std::chrono::steady_clock::time_point now) const;
+		int GetSwapInterval(const Window* window) const;
+		void UpdateWindows(Window* pacingWindow, std::chrono::steady_clock::time_point now,
+			std::chrono::steady_clock::duration eventPumpDuration);
+		void UpdateWindowsParallel(Window* pacingWindow, std::chrono::steady_clock::time_point now,
+			std::chrono::steady_clock::duration eventPumpDuration);
 
+		GLContextProbeSettings m_GLContextProbeSettings;
 		std::shared_ptr<GLContext> m_GLContext; // TODO: Do we actually ever want to release this (without exiting)
+		std::weak_ptr<Renderer> m_Renderer; // Windows own it, so it is destroyed with a GL context current
+		std::unique_ptr<TextureManager> m_TextureManager; // Outlives the managed windows, and so the renderer
+		uint64_t m_TextureResidencyGeneration = 0;
+		std::unique_ptr<GLWorkerPool> m_GLWorkers;
+		size_t m_GLWorkerCount = 1;
 
 		bool m_ShouldQuit = false;
+		bool m_IsHeadless = false;
+		std::atomic_bool m_IsWakeupPending = false;
+		std::atomic_bool m_IsUpdateQueuedForAll = false;
+		std::atomic<uint64_t> m_WakeupRequestCount = 0;
+		std::atomic<uint64_t> m_WakeupCoalescedCount = 0;
 		std::vector<Window*> m_Windows;
 		std::vector<std::unique_ptr<Window>> m_ManagedWindows;
+		std::unique_ptr<TaskQueue> m_PostedTasks;
+
+		PresentPolicy m_PresentPolicy = PresentPolicy::PacingWindow;
+		Window* m_PacingWindow = nullptr;
+		Window* m_ActivePacingWindow = nullptr;
+		bool m_AdaptiveVSyncEnabled = false;
+		std::chrono::steady_clock::duration m_FrameRateCapInterval{};
+		std::chrono::steady_clock::time_point m_LastFrameTime{};
+
+		bool m_IsParallelFrameBuildingEnabled = false;
+		std::unique_ptr<ThreadPool> m_ThreadPool;
+		std::vector<Window*> m_FrameWindows;
 
 		std::unique_ptr<ImFontAtlas> m_SharedFontAtlas;
+		uint64_t m_FontAtlasGeneration = 0; // Only touched by whoever is building the atlas
+		std::mutex m_ImGuiFrameMutex;
+		int m_ImGuiFramesInFlight = 0; // Between NewImGuiFrame() and EndImGuiFrame(), guarded by m_ImGuiFrameMutex
+		std::filesystem::path m_FontAtlasCachePath;
+
+		std::chrono::steady_clock::time_point m_StartupEpoch;
+		std::unique_ptr<StartupJobs> m_StartupJobs;
+		std::vector<StartupTimelineEntry> m_StartupTimeline;
+		bool m_IsStartupTimelineComplete = false;
 	};
+
+	template<typename TJob, typename TOnComplete>
+	void Application::PostGLJob(TJob job, TOnComplete onComplete)
+	{
+		using result_type = std::invoke_result_t<TJob&>;
+		if constexpr (std::is_void_v<result_type>)
+		{
+			PostGLJob(std::function<void()>(std::move(job)), std::function<void()>(std::move(onComplete)));
+		}
+		else
+		{
+			// std::function needs copyable callables, the result doesn't have to be
+			auto result = std::make_shared<std::optional<result_type>>();
+			PostGLJob(std::function<void()>([job = std::move(job), result]() mutable { result->emplace(job()); }),
+				std::function<void()>([onComplete = std::move(onComplete), result]() mutable { onComplete(std::move(**result)); }));
+		}
+	}
 }
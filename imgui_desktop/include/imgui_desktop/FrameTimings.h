@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Allocation.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace ImGuiDesktop
+{
+	enum class FramePhase
+	{
+		EventPump,      // Polling and dispatching SDL events (shared by every window drawn that frame)
+		Update,         // OnUpdate()
+		PreDraw,        // OnPreDraw(), backend and imgui NewFrame
+		Draw,           // OnDraw() and the main window around it
+		ImGuiRender,    // ImGui::Render()
+		RenderDrawData, // Submitting the draw data to GL
+		Swap,           // SDL_GL_SwapWindow, including any vsync wait
+		EndFrame,       // OnEndFrame()
+
+		COUNT,
+	};
+
+	// Measured with GL timer queries, see Window::SetGPUTimingEnabled()
+	enum class GPUFramePhase
+	{
+		RenderDrawData, // GPU execution of the submitted draw data
+		Swap,           // GPU work done by the swap/present (copies, compositing etc)
+
+		COUNT,
+	};
+
+	const char* GetFramePhaseName(FramePhase phase);
+	const char* GetFramePhaseName(GPUFramePhase phase);
+
+	// What the renderer did for a frame, for the shared OpenGL 3.2+ renderer only
+	struct RenderStats
+	{
+		uint64_t m_UploadBytes = 0;          // Vertex and index data written for the GPU
+		bool m_IsPersistentlyMapped = false; // Written straight into persistently mapped memory
+		uint32_t m_DrawCommands = 0;         // Visible ImDrawCmds, what the stock backend would issue as draw calls
+		uint32_t m_DrawCalls = 0;            // Draw calls actually issued after merging
+	};
+
+	struct FrameTimingSample
+	{
+		uint64_t m_FrameIndex = 0;
+		std::chrono::steady_clock::time_point m_StartTime{};
+		float m_TotalMS = 0;
+		std::array<float, size_t(FramePhase::COUNT)> m_PhaseMS{};
+
+		// imgui heap allocations made by this window during the frame
+		AllocationStats m_ImGuiAllocations;
+
+		// Left empty for frames rendered on the render thread
+		RenderStats m_RenderStats;
+
+		// GPU timings show up a few frames after the CPU ones, and not at all if GPU
+		// timing is disabled or unsupported.
+		bool m_HasGPUTimings = false;
+		std::array<float, size_t(GPUFramePhase::COUNT)> m_GPUPhaseMS{};
+
+		float GetPhaseMS(FramePhase phase) const { return m_PhaseMS[size_t(phase)]; }
+		float GetPhaseMS(GPUFramePhase phase) const { return m_GPUPhaseMS[size_t(phase)]; }
+	};
+
+	// All values are in milliseconds
+	struct FrameTimingStats
+	{
+		size_t m_SampleCount = 0;
+		float m_Min = 0;
+		float m_Avg = 0;
+		float m_P50 = 0;
+		float m_P95 = 0;
+		float m_P99 = 0;
+		float m_Max = 0;
+	};
+
+	// Fixed size ring buffer of the most recent frames. Never allocates.
+	class FrameTimingHistory
+	{
+	public:
+		static constexpr size_t CAPACITY = 512;
+
+		void Push(const FrameTimingSample& sample);
+		void Clear();
+
+		size_t GetSampleCount() const { return m_Count; }
+
+		// 0 is the oldest sample still in the buffer
+		const FrameTimingSample& GetSample(size_t index) const;
+		// nullptr if it's not (or no longer) in the buffer
+		FrameTimingSample* FindSample(uint64_t frameIndex);
+
+		// Copies the most recent samples (up to dst.size()) into dst, oldest first. Returns how many were copied.
+		size_t CopySamples(std::span<FrameTimingSample> dst) const;
+
+		// Stats over the most recent frameCount frames
+		FrameTimingStats GetStats(FramePhase phase, size_t frameCount = CAPACITY) const;
+		FrameTimingStats GetTotalStats(size_t frameCount = CAPACITY) const;
+		// Only counts the frames that have GPU timings
+		FrameTimingStats GetStats(GPUFramePhase phase, size_t frameCount = CAPACITY) const;
+
+	private:
+		template<typename TFunc> FrameTimingStats ComputeStats(size_t frameCount, const TFunc& getValue) const;
+
+		std::array<FrameTimingSample, CAPACITY> m_Samples{};
+		size_t m_Next = 0;
+		size_t m_Count = 0;
+	};
+}
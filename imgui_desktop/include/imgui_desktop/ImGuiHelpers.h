@@ -17,3 +17,11 @@
 	ImVec4 operator-(const ImVec4& other) const { return ImVec4(x - other.x, y - other.y, z - other.z, w - other.w); } \
 	ImVec4 operator*(float scalar) const { return ImVec4(x * scalar, y * scalar, z * scalar, w * scalar); } \
 	constexpr std::array<float, 4> to_array() const { return { x, y, z, w }; }
+
+#ifdef IMGUI_DESKTOP_THREAD_LOCAL_CONTEXT
+// Every thread gets its own current imgui context, which parallel frame building needs. This header is
+// imgui's IMGUI_USER_CONFIG, so the definition has to be visible when imgui itself is compiled too.
+struct ImGuiContext;
+extern thread_local ImGuiContext* g_ImGuiDesktopCurrentContext;
+#define GImGui g_ImGuiDesktopCurrentContext
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <imgui.h>
+#include <mh/types/disable_copy_move.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace ImGuiDesktop
+{
+	// Typed persistent state for the current imgui context, keyed by ImGuiID. Unlike ImGuiStorage, lookups
+	// hash straight into an open addressing table instead of binary searching a sorted vector, and values
+	// of any trivially copyable type live inline in an arena. Values never move once inserted, so pointers
+	// returned by Find()/Insert() stay valid until the context is destroyed, or until they're erased.
+	// Only to be used by whichever thread currently has the context.
+	class StateStore final : mh::disable_copy_move
+	{
+	public:
+		StateStore();
+		~StateStore();
+
+		// Store of the current imgui context, created on first use and destroyed along with the context
+		static StateStore& GetCurrent();
+
+		template<typename T> T* Find(ImGuiID id)
+		{
+			CheckType<T>();
+			return static_cast<T*>(FindRaw(id, sizeof(T)));
+		}
+
+		// Must not already exist
+		template<typename T> T* Insert(ImGuiID id, const T& value)
+		{
+			CheckType<T>();
+			return new (InsertRaw(id, sizeof(T), alignof(T))) T(value);
+		}
+
+		template<typename T> T Get(ImGuiID id, T defaultVal = {})
+		{
+			const T* value = Find<T>(id);
+			return value ? *value : defaultVal;
+		}
+
+		template<typename T> void Set(ImGuiID id, const T& value)
+		{
+			if (T* existing = Find<T>(id))
+				*existing = value;
+			else
+				Insert(id, value);
+		}
+
+		// Returns false if it didn't exist. The value's memory is only reclaimed along with the store.
+		bool Erase(ImGuiID id);
+
+		size_t GetCount() const { return m_Count; }
+
+	private:
+		template<typename T> static constexpr void CheckType()
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Values are stored inline and never destroyed");
+			static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types aren't supported");
+		}
+
+		struct Slot
+		{
+			ImGuiID m_ID = 0;
+			uint32_t m_Size = 0; // Catches the same ID being used with different types
+			void* m_Value = nullptr; // nullptr if empty
+		};
+
+		// Values are bump allocated out of these, so growing never moves existing ones
+		static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+		void* FindRaw(ImGuiID id, size_t size) const;
+		void* InsertRaw(ImGuiID id, size_t size, size_t alignment);
+		void* Allocate(size_t size, size_t alignment);
+		size_t GetSlotIndex(ImGuiID id) const;
+		size_t FindSlot(ImGuiID id) const; // m_Slots.size() if not found
+		void Grow();
+
+		std::vector<Slot> m_Slots; // Power of two sized, linear probing
+		uint32_t m_SlotBits = 0;
+		size_t m_Count = 0;
+
+		std::vector<std::unique_ptr<std::byte[]>> m_Chunks;
+		std::byte* m_ChunkPos = nullptr;
+		std::byte* m_ChunkEnd = nullptr;
+	};
+}
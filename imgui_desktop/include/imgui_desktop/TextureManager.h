@@ -0,0 +1,158 @@
+#pragma once
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace ImGuiDesktop
+{
+	// Stable for as long as the texture exists, even while it's evicted. Can be passed to
+	// ImGui::Image() (and friends) directly through GetTextureID().
+	enum class TextureHandle : uint64_t
+	{
+		Invalid = 0,
+	};
+
+	struct TextureManagerStats
+	{
+		uint32_t m_TextureCount = 0;
+		uint32_t m_ResidentCount = 0;   // Uploaded and ready to draw
+		uint32_t m_QueuedCount = 0;     // Waiting for (or in the middle of) an upload
+		size_t m_ResidentBytes = 0;     // GPU memory used by uploaded textures
+		size_t m_CPUBytes = 0;          // CPU copies kept around for re-uploading evicted textures
+		uint64_t m_UploadedBytes = 0;   // Since startup
+		uint64_t m_EvictionCount = 0;   // Since startup
+	};
+
+	// Textures for ImGui::Image(), uploaded in the background through a ring of pixel buffer objects,
+	// a few rows at a time so big images never cause a hitch. Once the resident textures exceed the
+	// memory budget, the ones that haven't been drawn for the longest are evicted, and uploaded again
+	// the next time they're drawn. Textures show up as nothing until they're resident.
+	// Only the shared OpenGL 3.2 renderer can draw these, older contexts ignore them.
+	class TextureManager final : mh::disable_copy_move
+	{
+	public:
+		TextureManager();
+		~TextureManager();
+
+		// Tightly packed RGBA8, top row first. Safe to call from any thread.
+		TextureHandle CreateTexture(uint32_t width, uint32_t height, std::vector<uint8_t> pixels);
+		// Safe to call from any thread, does nothing for handles that were already destroyed
+		void DestroyTexture(TextureHandle handle);
+
+		static void* GetTextureID(TextureHandle handle) { return reinterpret_cast<void*>(uintptr_t(handle)); }
+		static bool IsManagedTextureID(const void* textureID) { return (uintptr_t(textureID) & HANDLE_TAG) != 0; }
+
+		void SetMemoryBudget(size_t bytes);
+		size_t GetMemoryBudget() const;
+
+		// Upper limit on how much pixel data is uploaded per frame. Takes effect on the next frame.
+		void SetUploadBytesPerFrame(size_t bytes);
+		size_t GetUploadBytesPerFrame() const;
+
+		TextureManagerStats GetStats() const;
+
+		// Called whenever new work shows up (textures queued for upload or destroyed), so the main loop
+		// wakes up and calls ProcessUploads(). May be called from any thread.
+		void SetUpdateRequestFunc(std::function<void()> func);
+
+		// Internal, called by the framework on the main thread with the shared GL context current.
+		// A frame is one that some window actually rendered, polls in between only retire finished uploads.
+		// While isIdle (no window has a frame coming), there's nothing to hitch, so uploads go on without frames.
+		void BeginFrame();
+		void ProcessUploads(bool isIdle);
+		void ReleaseGLResources();
+		// Internal. Uploads in flight, or work waiting on a frame that has already begun, so ProcessUploads()
+		// has to keep being called even if nothing is being drawn.
+		bool HasPendingWork() const;
+		// Internal, called by the renderer with any context sharing objects with the main one.
+		// Returns the GL texture, or 0 if it isn't resident (yet).
+		uint32_t ResolveForDraw(const void* textureID);
+		// Changes whenever textures become resident or are evicted
+		uint64_t GetResidencyGeneration() const;
+		// The GetResidencyGeneration() at which the last of these became resident, 0 if none of them are.
+		// Frames drawing them look identical before and after, this is what tells them apart.
+		uint64_t GetResidencyGeneration(const std::vector<TextureHandle>& handles) const;
+
+	private:
+		// Tagged so they never collide with plain GL texture names cast to ImTextureID
+		static constexpr uintptr_t HANDLE_TAG = uintptr_t(1) << (sizeof(uintptr_t) * 8 - 1);
+		static constexpr unsigned INDEX_BITS = sizeof(uintptr_t) >= 8 ? 32 : 16;
+
+		// Textures are only deleted or evicted after going undrawn for this many frames, so a render
+		// thread that is a few frames behind never binds a deleted texture
+		static constexpr uint64_t MIN_UNUSED_FRAMES = 8;
+		static constexpr size_t PBO_COUNT = 3;
+
+		enum class State
+		{
+			Free,
+			Queued,    // In m_UploadQueue, possibly partially uploaded
+			Uploading, // Every row submitted, waiting on a fence
+			Resident,
+			Evicted,
+		};
+
+		struct Texture
+		{
+			uint32_t m_Generation = 1;
+			State m_State = State::Free;
+			uint32_t m_Width = 0;
+			uint32_t m_Height = 0;
+			uint32_t m_UploadedRows = 0;
+			uint32_t m_GLTexture = 0;
+			uint64_t m_LastUsedFrame = 0;
+			uint64_t m_ResidentGeneration = 0; // m_ResidencyGeneration when it last became resident
+			std::vector<uint8_t> m_Pixels;
+		};
+
+		struct PixelBuffer
+		{
+			uint32_t m_Buffer = 0;
+			size_t m_Capacity = 0;
+			void* m_Fence = nullptr; // GLsync
+			std::vector<TextureHandle> m_Completing; // Become resident once the fence signals
+		};
+
+		struct DeadTexture
+		{
+			uint32_t m_GLTexture;
+			uint64_t m_Frame;
+		};
+
+		Texture* Find(TextureHandle handle);
+		const Texture* Find(TextureHandle handle) const { return const_cast<TextureManager*>(this)->Find(handle); }
+		void Enqueue(TextureHandle handle, Texture& texture);
+		void ReleaseTexture(Texture& texture);
+		void RetireUploads(bool wait);
+		void SubmitUploads();
+		void Evict();
+		void RequestUpdate();
+		static size_t GetSize(const Texture& texture) { return size_t(texture.m_Width) * texture.m_Height * 4; }
+
+		mutable std::mutex m_Mutex;
+		std::vector<Texture> m_Textures;
+		std::vector<uint32_t> m_FreeIndices;
+		std::deque<TextureHandle> m_UploadQueue;
+		std::vector<DeadTexture> m_DeadTextures;
+
+		PixelBuffer m_PixelBuffers[PBO_COUNT];
+		size_t m_NextPixelBuffer = 0;
+
+		uint64_t m_FrameIndex = 0;
+		uint64_t m_LastProcessedFrame = uint64_t(-1);
+		uint64_t m_ResidencyGeneration = 0;
+		size_t m_MemoryBudget = 256 * 1024 * 1024;
+		size_t m_UploadBytesPerFrame = 8 * 1024 * 1024;
+		size_t m_ResidentBytes = 0;
+		uint64_t m_UploadedBytes = 0;
+		uint64_t m_EvictionCount = 0;
+
+		std::function<void()> m_UpdateRequestFunc;
+	};
+}
@@ -1,24 +1,49 @@
 #pragma once
 
+#include "Allocation.h"
+#include "FrameTimings.h"
 #include "GLContextVersion.h"
+#include "TextureManager.h"
 
 #include <mh/source_location.hpp>
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 struct SDL_Window;
+union SDL_Event;
 struct ImGuiContext;
 struct ImFontAtlas;
+struct ImDrawData;
 
 namespace ImGuiDesktop
 {
 	void SetLogFunction(std::function<void(const std::string_view&, const mh::source_location&)> func);
 
 	class Application;
+	class DamageTracker;
+	class Framebuffer;
 	class GLContext;
+	class GLContextScope;
+	class GPUFrameTimer;
+	class Renderer;
+	class RendererBuffers;
+	class RenderThread;
+	class TaskQueue;
+
+	struct RenderThreadStats
+	{
+		uint64_t m_SubmittedFrames = 0;
+		uint64_t m_PresentedFrames = 0;
+		uint64_t m_WaitCount = 0;                       // Frames where the UI thread had to wait for a free queue slot
+		std::chrono::steady_clock::duration m_WaitTime{}; // Total time spent waiting
+	};
 
 	class IWindowApplicationInterface
 	{
@@ -27,10 +52,27 @@ namespace ImGuiDesktop
 
 	private:
 		friend class Application;
-		virtual bool IsUpdateQueued() const = 0;
-		virtual void ClearUpdateQueued() = 0;
+		virtual bool SetUpdateQueued() = 0;
+		virtual bool ConsumeUpdateQueued() = 0;
 		virtual bool IsSleepingEnabled() const = 0;
+		virtual void MarkDirty() = 0;
+		virtual bool IsDirty() const = 0;
+		virtual std::chrono::steady_clock::time_point GetNextFrameTime() const = 0;
+		virtual bool IsFrameDue(std::chrono::steady_clock::time_point now) const = 0;
+		virtual void SetSwapInterval(int interval) = 0;
+		virtual void SetEventPumpDuration(std::chrono::steady_clock::duration duration) = 0;
+		virtual bool ProcessEvent(const SDL_Event& event) = 0;
+		virtual void RunPostedTasks() = 0;
+		virtual void OnTextureResidencyChanged() = 0;
+		// Whether a frame was rendered (or handed to the render thread) since the last call, rather than skipped
+		virtual bool ConsumeFrameRendered() = 0;
 		virtual void Update() = 0;
+
+		// Update() split into stages, for parallel frame building. Only UpdateBuildFrame() may run
+		// on another thread (concurrently with other windows' UpdateBuildFrame()).
+		virtual void UpdatePrepare() = 0;
+		virtual void UpdateBuildFrame() = 0;
+		virtual void UpdateFinish() = 0;
 		virtual void OnCloseButtonClicked() = 0;
 	};
 
@@ -44,13 +86,28 @@ namespace ImGuiDesktop
 
 		void GetWindowSize(uint32_t& w, uint32_t& h) const;
 
+		bool IsHeadless() const { return m_IsHeadless; }
+		// Size of the offscreen framebuffer for headless windows. Defaults to the size passed to the constructor.
+		void SetHeadlessSize(uint32_t width, uint32_t height);
+
+		// Copies the last rendered frame out as tightly packed RGBA8, top row first. Only works for windows
+		// that render offscreen (headless or damage rendering), returns false otherwise.
+		bool ReadPixels(std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height) const;
+
 		bool ShouldClose() const { return m_ShouldClose; }
 		void SetShouldClose(bool shouldClose = true) { m_ShouldClose = shouldClose; }
 
 		bool HasFocus() const;
 
+		// Wakes up the main loop and redraws this window. Safe to call from any thread,
+		// repeated calls before the next frame are coalesced into a single wakeup.
 		void QueueUpdate();
 
+		// Runs the task on the main thread before this window draws its next frame,
+		// then redraws this window. Safe to call from any thread. Tasks still pending when
+		// the window is destroyed are dropped without running.
+		void Post(std::function<void()> task);
+
 		void ShowWindow();
 		void HideWindow();
 		void RaiseWindow();
@@ -60,6 +117,53 @@ namespace ImGuiDesktop
 
 		float GetFPS() const { return m_FPS; }
 
+		// Per-phase CPU timings for the most recent frames this window actually drew
+		const FrameTimingHistory& GetFrameTimings() const { return m_FrameTimings; }
+
+		// Scratch memory for the current frame, reset right after OnEndFrame(). Main thread only.
+		FrameArena& GetFrameArena() { return m_FrameArena; }
+
+		// Builds frames on the main thread as usual, but renders and presents them on a dedicated thread with
+		// its own (shared) GL context, so a swap blocked on vsync doesn't hold up events or other windows.
+		// Requires OpenGL 3.2, and is ignored for headless windows. The render thread only sees a copy of the
+		// draw data, so draw callbacks run there must not use imgui. While enabled, OnPreDraw() can't draw with raw GL,
+		// ReadPixels() doesn't work and GPU timing is unavailable.
+		void SetThreadedRenderingEnabled(bool enabled) { m_IsThreadedRenderingEnabled = enabled; }
+		bool IsThreadedRenderingEnabled() const { return m_IsThreadedRenderingEnabled; }
+		// How many frames the main thread may run ahead of the render thread (1-3) before it has
+		// to wait. Higher values absorb more hitches but add latency.
+		void SetRenderQueueDepth(uint32_t frames) { m_RenderQueueDepth = frames; }
+		uint32_t GetRenderQueueDepth() const { return m_RenderQueueDepth; }
+		RenderThreadStats GetRenderThreadStats() const;
+
+		// Adds GPU timings to GetFrameTimings(), using timer queries that are read back a few frames
+		// later instead of stalling. Needs OpenGL 3.3 or ARB_timer_query, otherwise it turns itself back off.
+		void SetGPUTimingEnabled(bool enabled) { m_IsGPUTimingEnabled = enabled; }
+		bool IsGPUTimingEnabled() const { return m_IsGPUTimingEnabled; }
+
+		// Number of frames whose draw data was identical to the previous frame, so rendering and
+		// presenting were skipped. See CanSkipIdenticalFrames().
+		uint64_t GetSkippedFrameCount() const { return m_SkippedFrameCount; }
+
+		// Renders into a persistent offscreen buffer and only re-rasterizes the part of the window
+		// whose draw commands changed since the last frame. Helps a lot with fill-rate bound software
+		// GL on large, mostly static windows. Needs OpenGL 3, ignored on older contexts. While enabled,
+		// OnPreDraw() can't draw with raw GL either, the whole offscreen buffer is copied over it.
+		void SetDamageRenderingEnabled(bool enabled);
+		bool IsDamageRenderingEnabled() const { return m_IsDamageRenderingEnabled; }
+		// Fraction of the window that was re-rasterized in the last rendered frame
+		float GetLastDamageFraction() const { return m_LastDamageFraction.load(std::memory_order_relaxed); }
+
+		// Asks for a frame no later than the given time, without waking anything up
+		// right away. Multiple requests keep the earliest one. Main thread only.
+		void RequestFrameAt(std::chrono::steady_clock::time_point time);
+		void RequestFrameIn(std::chrono::steady_clock::duration delay);
+
+		// Keeps requesting frames at the given rate, for animations or polling.
+		// 0 (the default) disables this, so the window only draws when something happens.
+		void SetTargetFrameRate(float fps);
+		float GetTargetFrameRate() const;
+
 		Application& GetApplication() const { return *m_Application; }
 
 		bool IsPrimaryAppWindow() const { return m_IsPrimaryAppWindow; }
@@ -80,21 +184,78 @@ namespace ImGuiDesktop
 
 		bool IsSleepingEnabled() const override { return true; }
 
+		// Return false if something other than imgui draw data (for example raw GL in OnPreDraw)
+		// changes what ends up on screen, so frames are never skipped as identical.
+		virtual bool CanSkipIdenticalFrames() const { return true; }
+
 	private:
 		void OnUpdateInternal();
+		void OnPreDrawInternal();
 		void OnDrawInternal();
+		void OnEndFrameInternal();
+		RenderStats RenderFrame(ImDrawData* drawData);
+		RenderStats RenderDrawData(ImDrawData* drawData);
+		void Present(GLContextScope& scope, int swapInterval);
+		void RenderOnRenderThread(ImDrawData& drawData, int swapInterval);
+		void QueueFullRedraw();
+		void UpdateRenderThread(GLContextScope& scope);
+		void EndFramePhase(FramePhase phase);
+		void UpdateGPUTimer(const GLContextScope& scope);
 		void Update() override final;
+		void UpdatePrepare() override final;
+		void UpdateBuildFrame() override final;
+		void UpdateFinish() override final;
+
+		bool SetUpdateQueued() override final { return !m_IsUpdateQueued.exchange(true); }
+		bool ConsumeUpdateQueued() override final { return m_IsUpdateQueued.exchange(false); }
 
-		bool IsUpdateQueued() const override final { return m_IsUpdateQueued; }
-		void ClearUpdateQueued() override final { m_IsUpdateQueued = false; }
+		// Imgui has a lot of "measure, then update next frame" sort of stuff, so
+		// anything that dirties a window gets it an extra "settle" frame too.
+		void MarkDirty() override final { m_PendingFrameCount = 2; }
+		bool IsDirty() const override final { return m_PendingFrameCount > 0; }
+		std::chrono::steady_clock::time_point GetNextFrameTime() const override final { return m_NextFrameTime; }
+		bool IsFrameDue(std::chrono::steady_clock::time_point now) const override final;
+		void SetSwapInterval(int interval) override final { m_SwapInterval = interval; }
+		void SetEventPumpDuration(std::chrono::steady_clock::duration duration) override final { m_EventPumpDuration = duration; }
+		bool ProcessEvent(const SDL_Event& event) override final;
+		void RunPostedTasks() override final;
+		void OnTextureResidencyChanged() override final;
+		bool ConsumeFrameRendered() override final { return std::exchange(m_HasRenderedFrame, false); }
 
 		bool m_IsPrimaryAppWindow = false;
+		bool m_IsHeadless = false;
+		uint32_t m_HeadlessWidth = 0;
+		uint32_t m_HeadlessHeight = 0;
 		bool m_IsInit = false;
 		bool m_ShouldClose = false;
-		bool m_IsUpdateQueued = false;
-		float m_SleepDuration = 0.1f;
+		std::atomic_bool m_IsUpdateQueued = false;
+		uint8_t m_PendingFrameCount = 2;
+		std::chrono::steady_clock::time_point m_NextFrameTime = std::chrono::steady_clock::time_point::max();
+		std::chrono::steady_clock::duration m_TargetFrameInterval{};
+		int m_SwapInterval = 1;
+		bool m_IsAdaptiveVSyncSupported = true;
+		std::optional<uint64_t> m_LastDrawDataFingerprint;
+		std::optional<uint64_t> m_FrameFingerprint;
+		uint64_t m_SkippedFrameCount = 0;
+		bool m_HasRenderedFrame = false;
+		std::atomic_bool m_IsDamageRenderingEnabled = false; // Read by RenderFrame(), possibly on the render thread
+		std::atomic<float> m_LastDamageFraction = 1;
+		uint64_t m_TextureResidencyGeneration = 0; // When the last frame was rendered
+		std::vector<TextureHandle> m_DrawnTextures; // Managed textures in the last frame's draw data
+		std::atomic_uint32_t m_PendingFullRedraws = 0; // Consumed by RenderFrame(), possibly on the render thread
+		bool m_IsThreadedRenderingEnabled = false;
+		uint32_t m_RenderQueueDepth = 1;
 		float m_FPS = (1.0f / 60);
 		std::chrono::high_resolution_clock::time_point m_LastUpdate{};
+		std::chrono::steady_clock::duration m_EventPumpDuration{};
+		uint64_t m_FrameIndex = 0;
+		std::chrono::steady_clock::time_point m_FrameStartTime{};
+		std::chrono::steady_clock::time_point m_PhaseStart{};
+		AllocationStats m_FrameAllocations;
+		FrameTimingSample m_CurrentFrameTiming;
+		FrameTimingHistory m_FrameTimings;
+		FrameArena m_FrameArena;
+		bool m_IsGPUTimingEnabled = false;
 
 		auto EnterGLScope() const;
 
@@ -108,5 +269,13 @@ namespace ImGuiDesktop
 		std::unique_ptr<SDL_Window, CustomDeleters> m_WindowImpl;
 		std::unique_ptr<ImGuiContext, CustomDeleters> m_ImGuiContext;
 		std::shared_ptr<GLContext> m_GLContext;
+		std::unique_ptr<TaskQueue> m_PostedTasks;
+		std::unique_ptr<Framebuffer> m_Framebuffer;
+		std::unique_ptr<DamageTracker> m_DamageTracker;
+		std::unique_ptr<GPUFrameTimer> m_GPUTimer;
+		std::shared_ptr<Renderer> m_Renderer;
+		std::shared_ptr<GLContext> m_RenderGLContext;
+		std::unique_ptr<RendererBuffers> m_RenderThreadBuffers; // Owned by the render thread's context
+		std::unique_ptr<RenderThread> m_RenderThread;
 	};
 }
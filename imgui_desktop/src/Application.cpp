@@ -1,9 +1,22 @@
 #include "Application.h"
+#include "FontAtlasCache.h"
 #include "GLContext.h"
+#include "GLWorkerPool.h"
+#include "ImGuiAllocator.h"
+#include "ImGuiDesktopInternal.h"
+#include "Renderer.h"
+#include "StartupJobs.h"
+#include "TaskQueue.h"
+#include "TextureManager.h"
+#include "ThreadPool.h"
 #include "Window.h"
 
 #include <mh/error/ensure.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
 #ifdef IMGUI_USE_SDL2
 #include <imgui_impl_sdl.h>
 #include <SDL.h>
@@ -13,6 +26,10 @@ using namespace ImGuiDesktop;
 
 static constexpr const char SDL_WINDOW_PTR[] = __FILE__ " - {7825F11D-0FA9-4607-8B6F-977798B1C24C}";
 
+// How often the loop checks on background GL work while nothing else needs a frame. About as often as
+// it would have noticed while drawing at a high refresh rate, without spinning.
+static constexpr auto GL_WORK_POLL_INTERVAL = std::chrono::milliseconds(4);
+
 namespace
 {
 	static uint32_t GetCustomWindowEventType()
@@ -25,99 +42,208 @@ namespace
 	{
 		Wakeup,
 	};
+
+	// Returns 0 for events that aren't tied to a specific window
+	static uint32_t GetEventWindowID(const SDL_Event& event)
+	{
+		switch (event.type)
+		{
+		case SDL_WINDOWEVENT:
+			return event.window.windowID;
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			return event.key.windowID;
+		case SDL_TEXTEDITING:
+			return event.edit.windowID;
+		case SDL_TEXTINPUT:
+			return event.text.windowID;
+		case SDL_MOUSEMOTION:
+			return event.motion.windowID;
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			return event.button.windowID;
+		case SDL_MOUSEWHEEL:
+			return event.wheel.windowID;
+		case SDL_DROPFILE:
+		case SDL_DROPTEXT:
+		case SDL_DROPBEGIN:
+		case SDL_DROPCOMPLETE:
+			return event.drop.windowID;
+		default:
+			if (event.type >= SDL_USEREVENT && event.type < SDL_LASTEVENT)
+				return event.user.windowID;
+
+			return 0;
+		}
+	}
 }
 
 Application::Application() :
-	m_SharedFontAtlas(std::make_unique<ImFontAtlas>())
+	m_TextureManager(std::make_unique<TextureManager>()),
+	m_GLWorkers(std::make_unique<GLWorkerPool>()),
+	m_PostedTasks(std::make_unique<TaskQueue>()),
+	m_SharedFontAtlas(std::make_unique<ImFontAtlas>()),
+	m_StartupEpoch(std::chrono::steady_clock::now()),
+	m_StartupJobs(std::make_unique<StartupJobs>(m_StartupEpoch))
 {
+	// Before anything is allocated through imgui, the font atlas is built on another thread
+	InstallImGuiAllocator();
+
 	m_SharedFontAtlas->AddFontDefault();
+	m_StartupJobs->Add("Font atlas", [this] { BuildFontAtlas(); });
+
+	// New uploads or GL jobs only need the loop to run, windows redraw once something they show changes
+	const auto requestUpdate = [this] { QueueWakeup(); };
+	m_TextureManager->SetUpdateRequestFunc(requestUpdate);
+	m_GLWorkers->SetUpdateRequestFunc(requestUpdate);
 }
 
 Application::~Application() = default;
 
 void Application::Update()
 {
-	bool skipWait = false; //m_IsUpdateQueued || !IsSleepingEnabled();// || HasFocus();
+	using clock = std::chrono::steady_clock;
+
+	bool skipWait = false;
+	auto nextFrameTime = clock::time_point::max();
+
+	DrainPostedTasks();
+
+	// Workers share objects with the main context, so they can't start before it exists
+	if (m_GLContext)
+	{
+		if (!m_GLWorkers->IsStarted() && m_GLWorkers->HasJobs())
+			m_GLWorkers->Start(m_GLContext, m_GLWorkerCount);
+
+		// Same as Post(), whatever onComplete changed shows up right away. Until then, nothing has to redraw.
+		if (m_GLWorkers->ProcessCompletions())
+			m_IsUpdateQueuedForAll = true;
+	}
+
+	ConsumeQueuedUpdates();
 
 	for (Window* wnd : m_Windows)
 	{
 		IWindowApplicationInterface* interface = wnd;
-		if (interface->IsUpdateQueued() || !interface->IsSleepingEnabled())
-		{
+		if (interface->IsDirty() || !interface->IsSleepingEnabled())
 			skipWait = true;
-			interface->ClearUpdateQueued();
-		}
+
+		nextFrameTime = std::min(nextFrameTime, interface->GetNextFrameTime());
 	}
 
-	constexpr int SLEEP_DURATION = 100; // FIXME
-	if (skipWait || SDL_WaitEventTimeout(nullptr, SLEEP_DURATION))
+	if (skipWait)
+		nextFrameTime = clock::time_point::min();
+
+	// Nothing tells us when the GPU is done with an upload or a GL job, keep checking back without drawing anything
+	if ((!m_Renderer.expired() && m_TextureManager->HasPendingWork()) || m_GLWorkers->HasPendingCompletions())
+		nextFrameTime = std::min(nextFrameTime, clock::now() + GL_WORK_POLL_INTERVAL);
+
+	const bool hasFrameRateCap = m_FrameRateCapInterval > m_FrameRateCapInterval.zero();
+	if (hasFrameRateCap && nextFrameTime != clock::time_point::max())
+		nextFrameTime = std::max(nextFrameTime, m_LastFrameTime + m_FrameRateCapInterval);
+
+	if (nextFrameTime == clock::time_point::max())
+	{
+		// Nobody has anything scheduled, sleep until something happens
+		SDL_WaitEvent(nullptr);
+	}
+	else if (const auto now = clock::now(); nextFrameTime > now)
 	{
-		//m_IsUpdateQueued = false;
+		// Round up, waking up a millisecond early would just mean sleeping again
+		const auto timeout = std::chrono::ceil<std::chrono::milliseconds>(nextFrameTime - now);
+		SDL_WaitEventTimeout(nullptr, (int)std::min<std::chrono::milliseconds::rep>(
+			timeout.count(), std::numeric_limits<int>::max()));
+	}
+
+	// Whatever was posted while we slept shows up in this frame, not the next one
+	DrainPostedTasks();
 
-		bool shouldQueueWakeup = false;
+	const auto eventPumpStart = clock::now();
 
-		SDL_Event event;
-		while (SDL_PollEvent(&event))
+	SDL_Event event;
+	while (SDL_PollEvent(&event))
+	{
+		if (event.type == GetCustomWindowEventType())
 		{
-			shouldQueueWakeup = true;
+			switch ((CustomWindowEventCodes)event.user.code)
+			{
+			case CustomWindowEventCodes::Wakeup:
+				// Clear before consuming, so anything queued after this point sends a new wakeup
+				m_IsWakeupPending = false;
+				ConsumeQueuedUpdates();
+				break;
+			}
+
+			continue;
+		}
 
-			if (!ImGui_ImplSDL2_ProcessEvent(&event))
+		if (!DispatchEvent(event))
+		{
+			switch (event.type)
 			{
-				switch (event.type)
-				{
-				case SDL_QUIT:
-					m_ShouldQuit = true;
-					for (Window* wnd : m_Windows)
-						wnd->SetShouldClose(true);
+			case SDL_QUIT:
+				m_ShouldQuit = true;
+				for (Window* wnd : m_Windows)
+					wnd->SetShouldClose(true);
 
-					break;
+				break;
 
-				case SDL_USEREVENT:
+			case SDL_WINDOWEVENT:
+			{
+				switch (event.window.event)
 				{
-					switch ((CustomWindowEventCodes)event.user.code)
-					{
-					case CustomWindowEventCodes::Wakeup:
-						shouldQueueWakeup = false;
-						break;
-					}
-
-					break;
-				}
-				case SDL_WINDOWEVENT:
+				case SDL_WINDOWEVENT_CLOSE:
 				{
-					switch (event.window.event)
-					{
-					case SDL_WINDOWEVENT_CLOSE:
-					{
-						if (SDL_Window* window = SDL_GetWindowFromID(event.window.windowID))
-						{
-							if (auto managedWindow = mh_ensure(reinterpret_cast<Window*>(SDL_GetWindowData(window, SDL_WINDOW_PTR))))
-							{
-								static_cast<IWindowApplicationInterface*>(managedWindow)->OnCloseButtonClicked();
-							}
-						}
-
-						break;
-					}
-					}
+					if (auto managedWindow = mh_ensure(FindWindow(event.window.windowID)))
+						static_cast<IWindowApplicationInterface*>(managedWindow)->OnCloseButtonClicked();
+
 					break;
 				}
 				}
+				break;
+			}
 			}
 		}
-
-		// Imgui has a lot of "measure, then update next frame" sort of stuff.
-		// Make sure we have an "extra" update before every sleep to account for that.
-		if (shouldQueueWakeup)
-			QueueUpdate(nullptr);
 	}
 
-	// Cannot be a range based for loop, stuff might get removed/added during the updates
-	for (size_t i = 0; i < m_Windows.size(); i++)
-		static_cast<IWindowApplicationInterface*>(m_Windows[i])->Update();
+	const auto now = clock::now();
+	const auto eventPumpDuration = now - eventPumpStart;
+
+	// If an event woke us up before the frame rate cap allows another frame, its input has already been
+	// handed to imgui, but the frame itself waits for a later Update()
+	if (!hasFrameRateCap || now >= m_LastFrameTime + m_FrameRateCapInterval)
+	{
+		// The pacing window goes last, so everyone else has already presented by the time it blocks
+		Window* pacingWindow = ChoosePacingWindow(now);
+		m_ActivePacingWindow = pacingWindow;
+
+		ProcessTextureUploads(now);
+
+		if (m_ThreadPool)
+			UpdateWindowsParallel(pacingWindow, now, eventPumpDuration);
+		else
+			UpdateWindows(pacingWindow, now, eventPumpDuration);
+
+		// Only frames that were actually drawn count towards upload pacing and eviction, not skipped ones or polls
+		bool anyRendered = false;
+		for (Window* wnd : m_Windows)
+			anyRendered |= static_cast<IWindowApplicationInterface*>(wnd)->ConsumeFrameRendered();
+
+		if (anyRendered)
+			m_TextureManager->BeginFrame();
+
+		if (!m_IsStartupTimelineComplete && m_StartupJobs->IsJoined())
+		{
+			AddStartupPhase("First frame", now);
+			m_IsStartupTimelineComplete = true;
+		}
+	}
 
 	OnEndFrame();
 
+	// Windows keep the context bound between scopes, don't leave it bound while we're not running
+	GLContextScope::ReleaseCurrent();
+
 	for (auto it = m_ManagedWindows.begin(); it != m_ManagedWindows.end(); )
 	{
 		if (it->get()->ShouldClose())
@@ -132,13 +258,276 @@ void Application::Update()
 	}
 }
 
+void Application::UpdateWindows(Window* pacingWindow, std::chrono::steady_clock::time_point now,
+	std::chrono::steady_clock::duration eventPumpDuration)
+{
+	bool anyUpdated = false;
+
+	// Cannot be a range based for loop, stuff might get removed/added during the updates
+	for (size_t i = 0; i < m_Windows.size(); i++)
+	{
+		IWindowApplicationInterface* interface = m_Windows[i];
+		if (m_Windows[i] == pacingWindow || !interface->IsFrameDue(now))
+			continue;
+
+		interface->SetSwapInterval(GetSwapInterval(m_Windows[i]));
+		interface->SetEventPumpDuration(eventPumpDuration);
+		interface->Update();
+		anyUpdated = true;
+	}
+
+	if (pacingWindow && std::find(m_Windows.begin(), m_Windows.end(), pacingWindow) != m_Windows.end())
+	{
+		IWindowApplicationInterface* interface = pacingWindow;
+		interface->SetSwapInterval(GetSwapInterval(pacingWindow));
+		interface->SetEventPumpDuration(eventPumpDuration);
+		interface->Update();
+		anyUpdated = true;
+	}
+
+	if (anyUpdated)
+		m_LastFrameTime = now;
+}
+
+void Application::UpdateWindowsParallel(Window* pacingWindow, std::chrono::steady_clock::time_point now,
+	std::chrono::steady_clock::duration eventPumpDuration)
+{
+	m_FrameWindows.clear();
+	for (Window* wnd : m_Windows)
+	{
+		if (wnd != pacingWindow && static_cast<IWindowApplicationInterface*>(wnd)->IsFrameDue(now))
+			m_FrameWindows.push_back(wnd);
+	}
+
+	if (pacingWindow)
+		m_FrameWindows.push_back(pacingWindow);
+
+	if (m_FrameWindows.empty())
+		return;
+
+	const auto IsAlive = [&](Window* wnd) { return std::find(m_Windows.begin(), m_Windows.end(), wnd) != m_Windows.end(); };
+
+	// Cannot be range based for loops, stuff might get removed/added during the updates
+	for (size_t i = 0; i < m_FrameWindows.size(); i++)
+	{
+		if (!IsAlive(m_FrameWindows[i]))
+			continue;
+
+		IWindowApplicationInterface* interface = m_FrameWindows[i];
+		interface->SetSwapInterval(GetSwapInterval(m_FrameWindows[i]));
+		interface->SetEventPumpDuration(eventPumpDuration);
+		interface->UpdatePrepare();
+	}
+
+	std::erase_if(m_FrameWindows, [&](Window* wnd) { return !IsAlive(wnd); });
+
+	// The only shared thing imgui touches here is the font atlas. It was built by the backends during
+	// UpdatePrepare(), and from here on it's only read, apart from the Locked flag (see NewImGuiFrame()).
+	m_ThreadPool->ParallelFor(m_FrameWindows.size(), [&](size_t i)
+		{
+			static_cast<IWindowApplicationInterface*>(m_FrameWindows[i])->UpdateBuildFrame();
+		});
+
+	for (size_t i = 0; i < m_FrameWindows.size(); i++)
+	{
+		if (IsAlive(m_FrameWindows[i]))
+			static_cast<IWindowApplicationInterface*>(m_FrameWindows[i])->UpdateFinish();
+	}
+
+	m_LastFrameTime = now;
+}
+
+void Application::NewImGuiFrame()
+{
+	std::lock_guard lock(m_ImGuiFrameMutex);
+	m_ImGuiFramesInFlight++;
+	ImGui::NewFrame();
+}
+
+void Application::EndImGuiFrame()
+{
+	std::lock_guard lock(m_ImGuiFrameMutex);
+	ImGui::EndFrame();
+
+	// EndFrame() unlocks the atlas, but other windows may still be in the middle of their frames
+	if (--m_ImGuiFramesInFlight > 0)
+		m_SharedFontAtlas->Locked = true;
+}
+
+void Application::AbandonImGuiFrame()
+{
+	std::lock_guard lock(m_ImGuiFrameMutex);
+	if (--m_ImGuiFramesInFlight == 0)
+		m_SharedFontAtlas->Locked = false;
+}
+
+void Application::SetParallelFrameBuildingEnabled(bool enabled)
+{
+	if (enabled && !IsImGuiContextThreadLocal())
+	{
+#ifdef IMGUI_DESKTOP_THREAD_LOCAL_CONTEXT
+		PrintLogMsg("Parallel frame building requires imgui itself to be compiled with imgui_desktop/ImGuiHelpers.h as "
+			"IMGUI_USER_CONFIG, but it still has a global current context. Ignoring it");
+#else
+		PrintLogMsg("Parallel frame building requires building with IMGUI_DESKTOP_THREAD_LOCAL_CONTEXT, ignoring it");
+#endif
+		enabled = false;
+	}
+
+	m_IsParallelFrameBuildingEnabled = enabled;
+
+	if (enabled && !m_ThreadPool)
+		m_ThreadPool = std::make_unique<ThreadPool>();
+	else if (!enabled)
+		m_ThreadPool.reset();
+}
+
+void Application::PostGLJob(std::function<void()> job, std::function<void()> onComplete)
+{
+	m_GLWorkers->Post(std::move(job), std::move(onComplete));
+}
+
+void Application::DrainPostedTasks()
+{
+	// Cannot be a range based for loop, tasks might add/remove windows
+	m_PostedTasks->Drain();
+	for (size_t i = 0; i < m_Windows.size(); i++)
+		static_cast<IWindowApplicationInterface*>(m_Windows[i])->RunPostedTasks();
+}
+
 void Application::QueueUpdate(Window* window)
 {
+	if (window)
+		static_cast<IWindowApplicationInterface*>(window)->SetUpdateQueued();
+	else
+		m_IsUpdateQueuedForAll = true;
+
+	QueueWakeup();
+}
+
+void Application::QueueWakeup()
+{
+	m_WakeupRequestCount++;
+
+	// Before the first window initializes SDL there's no loop to wake, the first Update() gets to everything anyway
+	if (!SDL_WasInit(SDL_INIT_EVENTS))
+		return;
+
+	if (m_IsWakeupPending.exchange(true))
+	{
+		m_WakeupCoalescedCount++;
+		return;
+	}
+
 	SDL_Event event{};
 	event.type = GetCustomWindowEventType();
 	event.user.code = (int)CustomWindowEventCodes::Wakeup;
-	event.user.windowID = window ? SDL_GetWindowID(window->GetSDLWindow()) : 0;
-	SDL_PushEvent(&event);
+	if (SDL_PushEvent(&event) <= 0)
+	{
+		// Queue full or the event was filtered. Nothing will clear the flag, so the next request has to try again.
+		SDL_PRINT_AND_CLEAR_ERROR();
+		m_IsWakeupPending = false;
+	}
+}
+
+void Application::SetFrameRateCap(float fps)
+{
+	if (fps > 0)
+	{
+		m_FrameRateCapInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<float>(1 / fps));
+	}
+	else
+	{
+		m_FrameRateCapInterval = {};
+	}
+}
+
+float Application::GetFrameRateCap() const
+{
+	if (m_FrameRateCapInterval <= m_FrameRateCapInterval.zero())
+		return 0;
+
+	return 1 / std::chrono::duration_cast<std::chrono::duration<float>>(m_FrameRateCapInterval).count();
+}
+
+Window* Application::ChoosePacingWindow(std::chrono::steady_clock::time_point now) const
+{
+	if (m_PresentPolicy != PresentPolicy::PacingWindow)
+		return nullptr;
+
+	const auto IsCandidate = [&](Window* window)
+	{
+		return static_cast<const IWindowApplicationInterface*>(window)->IsFrameDue(now) && window->IsVisible();
+	};
+
+	if (m_PacingWindow && IsCandidate(m_PacingWindow))
+		return m_PacingWindow;
+
+	Window* firstVisible = nullptr;
+	for (Window* wnd : m_Windows)
+	{
+		if (!IsCandidate(wnd))
+			continue;
+
+		if (wnd->HasFocus())
+			return wnd;
+
+		if (!firstVisible)
+			firstVisible = wnd;
+	}
+
+	return firstVisible;
+}
+
+int Application::GetSwapInterval(const Window* window) const
+{
+	switch (m_PresentPolicy)
+	{
+	default:
+	case PresentPolicy::VSyncAll:
+		return 1;
+
+	case PresentPolicy::PacingWindow:
+		if (window == m_ActivePacingWindow)
+			return 1;
+
+		return m_AdaptiveVSyncEnabled ? -1 : 0;
+
+	case PresentPolicy::Immediate:
+		return 0;
+	}
+}
+
+void Application::Post(std::function<void()> task)
+{
+	m_PostedTasks->Push(std::move(task));
+	QueueUpdate(nullptr);
+}
+
+GLContextSwitchStats Application::GetGLContextSwitchStats() const
+{
+	return ImGuiDesktop::GetGLContextSwitchStats();
+}
+
+WakeupStats Application::GetWakeupStats() const
+{
+	WakeupStats stats;
+	stats.m_RequestCount = m_WakeupRequestCount;
+	stats.m_CoalescedCount = m_WakeupCoalescedCount;
+	return stats;
+}
+
+void Application::ConsumeQueuedUpdates()
+{
+	const bool all = m_IsUpdateQueuedForAll.exchange(false);
+
+	for (Window* wnd : m_Windows)
+	{
+		IWindowApplicationInterface* interface = wnd;
+		if (interface->ConsumeUpdateQueued() || all)
+			interface->MarkDirty();
+	}
 }
 
 bool Application::ShouldQuit() const
@@ -174,11 +563,42 @@ void Application::AddWindow(Window* window)
 void Application::RemoveWindow(Window* window)
 {
 	mh_ensure(std::erase(m_Windows, window));
+
+	if (m_PacingWindow == window)
+		m_PacingWindow = nullptr;
+	if (m_ActivePacingWindow == window)
+		m_ActivePacingWindow = nullptr;
+}
+
+Window* Application::FindWindow(uint32_t windowID) const
+{
+	if (SDL_Window* window = SDL_GetWindowFromID(windowID))
+		return reinterpret_cast<Window*>(SDL_GetWindowData(window, SDL_WINDOW_PTR));
+
+	return nullptr;
+}
+
+bool Application::DispatchEvent(const SDL_Event& event)
+{
+	if (const auto windowID = GetEventWindowID(event); windowID != 0)
+	{
+		// Events for windows we don't own (or that are already gone) are dropped
+		if (Window* window = FindWindow(windowID))
+			return static_cast<IWindowApplicationInterface*>(window)->ProcessEvent(event);
+
+		return false;
+	}
+
+	bool handled = false;
+	for (Window* wnd : m_Windows)
+		handled |= static_cast<IWindowApplicationInterface*>(wnd)->ProcessEvent(event);
+
+	return handled;
 }
 
 std::shared_ptr<GLContext> Application::GetOrCreateGLContext(SDL_Window* window)
 {
-	auto context = ImGuiDesktop::GetOrCreateGLContext(window);
+	auto context = ImGuiDesktop::GetOrCreateGLContext(window, m_GLContextProbeSettings);
 
 	if (!m_GLContext)
 	{
@@ -194,3 +614,130 @@ std::shared_ptr<GLContext> Application::GetOrCreateGLContext(SDL_Window* window)
 
 	return context;
 }
+
+void Application::ProcessTextureUploads(std::chrono::steady_clock::time_point now)
+{
+	// Only the shared renderer can draw managed textures, and it's gone with the last window that had it
+	if (m_Renderer.expired() || m_Windows.empty())
+		return;
+
+	const bool isIdle = std::none_of(m_Windows.begin(), m_Windows.end(), [&](const Window* wnd)
+		{
+			const IWindowApplicationInterface* interface = wnd;
+			return interface->IsFrameDue(now) || interface->GetNextFrameTime() != std::chrono::steady_clock::time_point::max();
+		});
+
+	{
+		GLContextScope scope(m_Windows.front()->GetSDLWindow(), m_GLContext);
+		m_TextureManager->ProcessUploads(isIdle);
+	}
+
+	// Only windows that draw a texture that just became resident have to redraw
+	if (const uint64_t generation = m_TextureManager->GetResidencyGeneration(); generation != m_TextureResidencyGeneration)
+	{
+		m_TextureResidencyGeneration = generation;
+		for (Window* wnd : m_Windows)
+			static_cast<IWindowApplicationInterface*>(wnd)->OnTextureResidencyChanged();
+	}
+}
+
+std::shared_ptr<Renderer> Application::GetOrCreateRenderer(const GLContextScope& scope)
+{
+	auto renderer = m_Renderer.lock();
+	if (!renderer)
+	{
+		renderer = std::make_shared<Renderer>(scope, *m_TextureManager);
+		m_Renderer = renderer;
+	}
+
+	return renderer;
+}
+
+uint64_t Application::EnsureFontAtlasBuilt()
+{
+	JoinStartupJobs();
+
+	if (!m_SharedFontAtlas->IsBuilt())
+		BuildFontAtlas();
+
+	return m_FontAtlasGeneration;
+}
+
+void Application::BuildFontAtlas()
+{
+	ImFontAtlas& atlas = *m_SharedFontAtlas;
+	if (atlas.IsBuilt())
+		return;
+
+	// Rebuilt atlases can end up in an allocation of the same size at the same address, so renderers
+	// can't tell from the pixels alone
+	if (!m_FontAtlasCachePath.empty() && LoadFontAtlasCache(atlas, m_FontAtlasCachePath))
+	{
+		m_FontAtlasGeneration++;
+		return;
+	}
+
+	if (!atlas.Build())
+	{
+		PrintLogMsg("Failed to build the font atlas");
+		return;
+	}
+
+	m_FontAtlasGeneration++;
+
+	if (!m_FontAtlasCachePath.empty())
+		SaveFontAtlasCache(atlas, m_FontAtlasCachePath);
+}
+
+ImFontAtlas& Application::GetFontAtlas() const
+{
+	// Only the worker thread touches the atlas until this returns
+	m_StartupJobs->Wait();
+	return *m_SharedFontAtlas;
+}
+
+void Application::AddStartupJob(std::string name, std::function<void()> job)
+{
+	if (!m_StartupJobs->IsStarted())
+	{
+		m_StartupJobs->Add(std::move(name), std::move(job));
+		return;
+	}
+
+	// The worker may still be running, and owns its own timeline until it's joined
+	const auto start = std::chrono::steady_clock::now();
+	job();
+
+	if (!m_IsStartupTimelineComplete)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		m_StartupTimeline.push_back({ std::move(name), start - m_StartupEpoch, now - start, false });
+	}
+}
+
+void Application::StartStartupJobs()
+{
+	m_StartupJobs->Start();
+}
+
+void Application::JoinStartupJobs()
+{
+	if (m_StartupJobs->IsJoined())
+		return;
+
+	const auto start = std::chrono::steady_clock::now();
+	m_StartupJobs->Join(m_StartupTimeline);
+	AddStartupPhase("Waiting for startup jobs", start);
+
+	std::stable_sort(m_StartupTimeline.begin(), m_StartupTimeline.end(),
+		[](const StartupTimelineEntry& a, const StartupTimelineEntry& b) { return a.m_Start < b.m_Start; });
+}
+
+void Application::AddStartupPhase(const char* name, std::chrono::steady_clock::time_point start)
+{
+	if (m_IsStartupTimelineComplete)
+		return;
+
+	const auto now = std::chrono::steady_clock::now();
+	m_StartupTimeline.push_back({ name, start - m_StartupEpoch, now - start, false });
+}
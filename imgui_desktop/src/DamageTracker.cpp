@@ -0,0 +1,216 @@
+#include "DamageTracker.h"
+#include "DrawDataFingerprint.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace ImGuiDesktop;
+
+namespace
+{
+	// If more than this fraction of the display changed, a full redraw is just as cheap
+	static constexpr float FULL_REDRAW_THRESHOLD = 0.6f;
+
+	static ImVec4 Intersect(const ImVec4& a, const ImVec4& b)
+	{
+		return ImVec4(std::max(a.x, b.x), std::max(a.y, b.y), std::min(a.z, b.z), std::min(a.w, b.w));
+	}
+
+	static void Expand(ImVec4& rect, const ImVec4& other)
+	{
+		if (other.z <= other.x || other.w <= other.y)
+			return;
+
+		if (rect.z <= rect.x || rect.w <= rect.y)
+		{
+			rect = other;
+			return;
+		}
+
+		rect = ImVec4(std::min(rect.x, other.x), std::min(rect.y, other.y), std::max(rect.z, other.z), std::max(rect.w, other.w));
+	}
+}
+
+std::optional<ImVec4> DamageTracker::Update(const ImDrawData& drawData)
+{
+	const bool displayChanged = drawData.DisplayPos != m_DisplayPos || drawData.DisplaySize != m_DisplaySize ||
+		drawData.FramebufferScale != m_FramebufferScale;
+
+	m_DisplayPos = drawData.DisplayPos;
+	m_DisplaySize = drawData.DisplaySize;
+	m_FramebufferScale = drawData.FramebufferScale;
+
+	m_Previous.swap(m_Current);
+	Collect(drawData);
+
+	const bool wasValid = m_IsValid;
+	m_IsValid = true;
+
+	// Callbacks can draw anything, anywhere
+	for (int i = 0; i < drawData.CmdListsCount; i++)
+	{
+		for (const ImDrawCmd& cmd : drawData.CmdLists[i]->CmdBuffer)
+		{
+			if (cmd.UserCallback)
+			{
+				m_IsValid = false;
+				return std::nullopt;
+			}
+		}
+	}
+
+	if (!wasValid || displayChanged)
+		return std::nullopt;
+
+	// Match identical commands between frames. Sorting by hash keeps this O(n log n)
+	// instead of comparing every command against every other one.
+	const auto byHash = [](const CmdInfo& a, const CmdInfo& b) { return a.m_Hash < b.m_Hash; };
+	auto& previous = m_SortedPrevious;
+	auto& current = m_SortedCurrent;
+	previous.assign(m_Previous.begin(), m_Previous.end());
+	current.assign(m_Current.begin(), m_Current.end());
+	std::sort(previous.begin(), previous.end(), byHash);
+	std::sort(current.begin(), current.end(), byHash);
+
+	constexpr uint32_t UNMATCHED = std::numeric_limits<uint32_t>::max();
+	m_MatchedOrder.assign(m_Current.size(), UNMATCHED);
+
+	ImVec4 damage{};
+	auto prevIt = previous.begin();
+	auto curIt = current.begin();
+	while (prevIt != previous.end() || curIt != current.end())
+	{
+		if (curIt == current.end() || (prevIt != previous.end() && prevIt->m_Hash < curIt->m_Hash))
+		{
+			Expand(damage, prevIt->m_Rect); // Went away
+			++prevIt;
+		}
+		else if (prevIt == previous.end() || curIt->m_Hash < prevIt->m_Hash)
+		{
+			Expand(damage, curIt->m_Rect); // Showed up
+			++curIt;
+		}
+		else
+		{
+			m_MatchedOrder[curIt->m_Order] = prevIt->m_Order;
+			++prevIt;
+			++curIt;
+		}
+	}
+
+	// Identical commands that were drawn in a different order can still change the result
+	// where they overlap, so anything that moved backwards relative to the others is damaged too.
+	uint32_t lastPrevOrder = 0;
+	bool hasLastPrevOrder = false;
+	for (const CmdInfo& info : m_Current)
+	{
+		const uint32_t prevOrder = m_MatchedOrder[info.m_Order];
+		if (prevOrder == UNMATCHED)
+			continue;
+
+		if (hasLastPrevOrder && prevOrder < lastPrevOrder)
+		{
+			Expand(damage, info.m_Rect);
+			continue;
+		}
+
+		lastPrevOrder = prevOrder;
+		hasLastPrevOrder = true;
+	}
+
+	// Snap outwards to whole framebuffer pixels
+	if (damage.z > damage.x && damage.w > damage.y)
+	{
+		const ImVec2 scale = drawData.FramebufferScale;
+		damage.x = std::floor((damage.x - m_DisplayPos.x) * scale.x) / scale.x + m_DisplayPos.x;
+		damage.y = std::floor((damage.y - m_DisplayPos.y) * scale.y) / scale.y + m_DisplayPos.y;
+		damage.z = std::ceil((damage.z - m_DisplayPos.x) * scale.x) / scale.x + m_DisplayPos.x;
+		damage.w = std::ceil((damage.w - m_DisplayPos.y) * scale.y) / scale.y + m_DisplayPos.y;
+
+		const float damageArea = (damage.z - damage.x) * (damage.w - damage.y);
+		const float displayArea = m_DisplaySize.x * m_DisplaySize.y;
+		if (damageArea >= displayArea * FULL_REDRAW_THRESHOLD)
+			return std::nullopt;
+	}
+
+	return damage;
+}
+
+void DamageTracker::Invalidate()
+{
+	m_IsValid = false;
+}
+
+void DamageTracker::ClipDrawData(ImDrawData& drawData, const ImVec4& rect)
+{
+	for (int i = 0; i < drawData.CmdListsCount; i++)
+	{
+		for (ImDrawCmd& cmd : drawData.CmdLists[i]->CmdBuffer)
+		{
+			cmd.ClipRect = Intersect(cmd.ClipRect, rect);
+
+			// Keep it well formed (zero sized rather than inverted), so the renderer just skips it
+			cmd.ClipRect.z = std::max(cmd.ClipRect.z, cmd.ClipRect.x);
+			cmd.ClipRect.w = std::max(cmd.ClipRect.w, cmd.ClipRect.y);
+		}
+	}
+}
+
+void DamageTracker::Collect(const ImDrawData& drawData)
+{
+	m_Current.clear();
+
+	for (int i = 0; i < drawData.CmdListsCount; i++)
+	{
+		const ImDrawList* cmdList = drawData.CmdLists[i];
+		for (const ImDrawCmd& cmd : cmdList->CmdBuffer)
+		{
+			if (cmd.UserCallback || cmd.ElemCount == 0)
+				continue;
+
+			const ImDrawIdx* indices = cmdList->IdxBuffer.Data + cmd.IdxOffset;
+
+			unsigned minIndex = std::numeric_limits<unsigned>::max();
+			unsigned maxIndex = 0;
+			for (unsigned e = 0; e < cmd.ElemCount; e++)
+			{
+				minIndex = std::min<unsigned>(minIndex, indices[e]);
+				maxIndex = std::max<unsigned>(maxIndex, indices[e]);
+			}
+
+			const ImDrawVert* vertices = cmdList->VtxBuffer.Data + cmd.VtxOffset + minIndex;
+			const unsigned vertexCount = maxIndex - minIndex + 1;
+
+			ImVec4 bounds(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+				std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+			for (unsigned v = 0; v < vertexCount; v++)
+			{
+				bounds.x = std::min(bounds.x, vertices[v].pos.x);
+				bounds.y = std::min(bounds.y, vertices[v].pos.y);
+				bounds.z = std::max(bounds.z, vertices[v].pos.x);
+				bounds.w = std::max(bounds.w, vertices[v].pos.y);
+			}
+
+			// Hash what this command draws, independent of where it sits in the buffers
+			FingerprintHasher hasher;
+			hasher.AddValue(cmd.ClipRect);
+			hasher.AddValue(cmd.TextureId);
+			hasher.AddValue(cmd.ElemCount);
+			for (unsigned e = 0; e < cmd.ElemCount; e++)
+				hasher.AddValue(uint32_t(indices[e] - minIndex));
+			hasher.Add(vertices, vertexCount * sizeof(ImDrawVert));
+
+			// Antialiased edges bleed about a pixel outside the vertices
+			bounds.x -= 1;
+			bounds.y -= 1;
+			bounds.z += 1;
+			bounds.w += 1;
+
+			CmdInfo& info = m_Current.emplace_back();
+			info.m_Hash = hasher.GetValue();
+			info.m_Rect = Intersect(bounds, cmd.ClipRect);
+			info.m_Order = uint32_t(m_Current.size() - 1);
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace ImGuiDesktop
+{
+	// Compares each frame's draw commands against the previous frame's to find the part of the
+	// screen that actually changed.
+	class DamageTracker final
+	{
+	public:
+		// Returns the changed area in imgui display coordinates, or nullopt if the whole
+		// display needs to be redrawn. An empty rect (z <= x) means nothing changed.
+		std::optional<ImVec4> Update(const ImDrawData& drawData);
+
+		// Forget the previous frame, so the next Update() damages everything
+		void Invalidate();
+
+		// Restricts every draw command to the given rect, so re-rendering only touches that area
+		static void ClipDrawData(ImDrawData& drawData, const ImVec4& rect);
+
+	private:
+		struct CmdInfo
+		{
+			uint64_t m_Hash;
+			ImVec4 m_Rect;
+			uint32_t m_Order;
+		};
+
+		void Collect(const ImDrawData& drawData);
+
+		std::vector<CmdInfo> m_Previous;
+		std::vector<CmdInfo> m_Current;
+		std::vector<CmdInfo> m_SortedPrevious;
+		std::vector<CmdInfo> m_SortedCurrent;
+		std::vector<uint32_t> m_MatchedOrder;
+		ImVec2 m_DisplayPos{};
+		ImVec2 m_DisplaySize{};
+		ImVec2 m_FramebufferScale{};
+		bool m_IsValid = false;
+	};
+}
@@ -0,0 +1,102 @@
+#include "DrawDataFingerprint.h"
+
+#include <imgui.h>
+
+#include <bit>
+#include <cstring>
+
+using namespace ImGuiDesktop;
+
+namespace
+{
+	static constexpr uint64_t PRIME_1 = 0x9E3779B97F4A7C15;
+	static constexpr uint64_t PRIME_2 = 0xBF58476D1CE4E5B9;
+	static constexpr uint64_t PRIME_3 = 0x94D049BB133111EB;
+
+	static uint64_t Mix(uint64_t state, uint64_t value)
+	{
+		return std::rotl(state ^ (value * PRIME_1), 31) * PRIME_2;
+	}
+
+	static uint64_t Read64(const uint8_t* data)
+	{
+		uint64_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+}
+
+void FingerprintHasher::Add(const void* data, size_t size)
+{
+	auto bytes = static_cast<const uint8_t*>(data);
+	m_Length += size;
+
+	// Four independent lanes so the multiplies can overlap
+	if (size >= 32)
+	{
+		uint64_t lanes[4] = { m_State, m_State + PRIME_1, m_State + PRIME_2, m_State + PRIME_3 };
+
+		for (; size >= 32; bytes += 32, size -= 32)
+		{
+			lanes[0] = Mix(lanes[0], Read64(bytes + 0));
+			lanes[1] = Mix(lanes[1], Read64(bytes + 8));
+			lanes[2] = Mix(lanes[2], Read64(bytes + 16));
+			lanes[3] = Mix(lanes[3], Read64(bytes + 24));
+		}
+
+		m_State = Mix(Mix(Mix(Mix(m_State, lanes[0]), lanes[1]), lanes[2]), lanes[3]);
+	}
+
+	for (; size >= 8; bytes += 8, size -= 8)
+		m_State = Mix(m_State, Read64(bytes));
+
+	if (size > 0)
+	{
+		uint64_t tail = 0;
+		std::memcpy(&tail, bytes, size);
+		m_State = Mix(m_State, tail);
+	}
+}
+
+uint64_t FingerprintHasher::GetValue() const
+{
+	uint64_t value = m_State ^ m_Length;
+	value ^= value >> 33;
+	value *= PRIME_3;
+	value ^= value >> 29;
+	return value;
+}
+
+std::optional<uint64_t> ImGuiDesktop::GetDrawDataFingerprint(const ImDrawData& drawData)
+{
+	FingerprintHasher hasher;
+	hasher.AddValue(drawData.DisplayPos);
+	hasher.AddValue(drawData.DisplaySize);
+	hasher.AddValue(drawData.FramebufferScale);
+	hasher.AddValue(drawData.CmdListsCount);
+
+	for (int i = 0; i < drawData.CmdListsCount; i++)
+	{
+		const ImDrawList* cmdList = drawData.CmdLists[i];
+
+		hasher.AddValue(cmdList->CmdBuffer.Size);
+		for (const ImDrawCmd& cmd : cmdList->CmdBuffer)
+		{
+			if (cmd.UserCallback)
+				return std::nullopt;
+
+			hasher.AddValue(cmd.ClipRect);
+			hasher.AddValue(cmd.TextureId);
+			hasher.AddValue(cmd.VtxOffset);
+			hasher.AddValue(cmd.IdxOffset);
+			hasher.AddValue(cmd.ElemCount);
+		}
+
+		hasher.AddValue(cmdList->IdxBuffer.Size);
+		hasher.Add(cmdList->IdxBuffer.Data, cmdList->IdxBuffer.size_in_bytes());
+		hasher.AddValue(cmdList->VtxBuffer.Size);
+		hasher.Add(cmdList->VtxBuffer.Data, cmdList->VtxBuffer.size_in_bytes());
+	}
+
+	return hasher.GetValue();
+}
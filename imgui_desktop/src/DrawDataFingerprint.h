@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+struct ImDrawData;
+
+namespace ImGuiDesktop
+{
+	// Fast, non-cryptographic 64-bit hash for change detection
+	class FingerprintHasher final
+	{
+	public:
+		void Add(const void* data, size_t size);
+
+		template<typename T>
+		void AddValue(const T& value) { Add(&value, sizeof(value)); }
+
+		uint64_t GetValue() const;
+
+	private:
+		uint64_t m_State = 0x243F6A8885A308D3;
+		uint64_t m_Length = 0;
+	};
+
+	// Hash of everything in the draw data that affects the rendered image: display rect,
+	// command lists, vertex/index buffers, clip rects and texture IDs. Returns nullopt if
+	// the draw data contains user callbacks, since we can't know what those will draw.
+	std::optional<uint64_t> GetDrawDataFingerprint(const ImDrawData& drawData);
+}
@@ -0,0 +1,403 @@
+#include "FontAtlasCache.h"
+#include "DrawDataFingerprint.h"
+#include "ImGuiDesktopInternal.h"
+
+#include <imgui.h>
+#include <mh/text/format.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+using namespace ImGuiDesktop;
+
+// File layout: Header, then FontRecord[m_FontCount], then the sections at the offsets in the
+// header. Everything is 8 byte aligned so the file can be used in place (read or mapped).
+namespace
+{
+	static constexpr char CACHE_MAGIC[8] = { 'I', 'M', 'D', 'F', 'O', 'N', 'T', '1' };
+
+	// Bump whenever the layout below changes
+	static constexpr uint32_t CACHE_FORMAT_VERSION = 1;
+
+	struct Header
+	{
+		char m_Magic[8];
+		uint32_t m_FormatVersion;
+		uint32_t m_HeaderSize;
+		uint64_t m_Key;
+
+		int32_t m_TexWidth;
+		int32_t m_TexHeight;
+		uint32_t m_BytesPerPixel; // 1 = alpha8, 4 = rgba32
+		uint32_t m_TexPixelsUseColors;
+		ImVec2 m_TexUvScale;
+		ImVec2 m_TexUvWhitePixel;
+		ImVec4 m_TexUvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+		int32_t m_PackIdMouseCursors;
+		int32_t m_PackIdLines;
+
+		uint32_t m_FontCount;
+		uint32_t m_CustomRectCount;
+		uint64_t m_CustomRectsOffset;
+		uint64_t m_PixelsOffset;
+		uint64_t m_FileSize;
+	};
+
+	struct FontRecord
+	{
+		float m_FontSize;
+		float m_Ascent;
+		float m_Descent;
+		float m_Scale;
+		int32_t m_ConfigDataIndex;
+		int32_t m_ConfigDataCount;
+		int32_t m_MetricsTotalSurface;
+		uint32_t m_FallbackChar;
+		uint32_t m_EllipsisChar;
+		uint32_t m_GlyphCount;
+		uint64_t m_GlyphsOffset;
+	};
+
+	struct CustomRectRecord
+	{
+		ImFontAtlasCustomRect m_Rect;
+		int32_t m_FontIndex; // -1 if not tied to a font
+	};
+
+	static constexpr uint64_t Align8(uint64_t value) { return (value + 7) & ~uint64_t(7); }
+
+	static int32_t FindFontIndex(const ImFontAtlas& atlas, const ImFont* font)
+	{
+		for (int i = 0; i < atlas.Fonts.Size; i++)
+		{
+			if (atlas.Fonts[i] == font)
+				return i;
+		}
+
+		return -1;
+	}
+
+	static int32_t FindConfigIndex(const ImFontAtlas& atlas, const ImFontConfig* config)
+	{
+		if (!config || atlas.ConfigData.Size == 0)
+			return -1;
+
+		const auto index = config - atlas.ConfigData.Data;
+		return (index >= 0 && index < atlas.ConfigData.Size) ? int32_t(index) : -1;
+	}
+}
+
+uint64_t ImGuiDesktop::GetFontAtlasCacheKey(const ImFontAtlas& atlas)
+{
+	FingerprintHasher hasher;
+	hasher.AddValue(CACHE_FORMAT_VERSION);
+	hasher.AddValue(IMGUI_VERSION_NUM);
+	hasher.AddValue(sizeof(ImWchar));
+	hasher.AddValue(sizeof(ImFontGlyph));
+	hasher.AddValue(atlas.Flags);
+	hasher.AddValue(atlas.TexDesiredWidth);
+	hasher.AddValue(atlas.TexGlyphPadding);
+
+	hasher.AddValue(atlas.Fonts.Size);
+	for (const ImFontConfig& config : atlas.ConfigData)
+	{
+		hasher.AddValue(config.FontDataSize);
+		if (config.FontData && config.FontDataSize > 0)
+			hasher.Add(config.FontData, size_t(config.FontDataSize));
+
+		hasher.AddValue(config.FontNo);
+		hasher.AddValue(config.SizePixels);
+		hasher.AddValue(config.OversampleH);
+		hasher.AddValue(config.OversampleV);
+		hasher.AddValue(config.PixelSnapH);
+		hasher.AddValue(config.GlyphExtraSpacing.x);
+		hasher.AddValue(config.GlyphExtraSpacing.y);
+		hasher.AddValue(config.GlyphOffset.x);
+		hasher.AddValue(config.GlyphOffset.y);
+		hasher.AddValue(config.GlyphMinAdvanceX);
+		hasher.AddValue(config.GlyphMaxAdvanceX);
+		hasher.AddValue(config.MergeMode);
+		hasher.AddValue(config.FontBuilderFlags);
+		hasher.AddValue(config.RasterizerMultiply);
+		hasher.AddValue(config.EllipsisChar);
+		hasher.AddValue(FindFontIndex(atlas, config.DstFont));
+
+		// Zero terminated list of ranges
+		if (config.GlyphRanges)
+		{
+			for (const ImWchar* range = config.GlyphRanges; *range; range++)
+				hasher.AddValue(*range);
+		}
+		hasher.AddValue(ImWchar(0));
+	}
+
+	hasher.AddValue(atlas.CustomRects.Size);
+	for (const ImFontAtlasCustomRect& rect : atlas.CustomRects)
+	{
+		hasher.AddValue(rect.Width);
+		hasher.AddValue(rect.Height);
+		hasher.AddValue(rect.GlyphID);
+		hasher.AddValue(rect.GlyphAdvanceX);
+		hasher.AddValue(rect.GlyphOffset.x);
+		hasher.AddValue(rect.GlyphOffset.y);
+		hasher.AddValue(FindFontIndex(atlas, rect.Font));
+	}
+
+	return hasher.GetValue();
+}
+
+bool ImGuiDesktop::LoadFontAtlasCache(ImFontAtlas& atlas, const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::vector<uint64_t> storage; // uint64_t for alignment
+	const auto fileSize = uint64_t(file.tellg());
+	if (fileSize < sizeof(Header))
+		return false;
+
+	storage.resize(size_t((fileSize + 7) / 8));
+	const auto data = reinterpret_cast<const std::byte*>(storage.data());
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(storage.data()), std::streamsize(fileSize)))
+		return false;
+
+	const auto& header = *reinterpret_cast<const Header*>(data);
+	if (std::memcmp(header.m_Magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) ||
+		header.m_FormatVersion != CACHE_FORMAT_VERSION ||
+		header.m_HeaderSize != sizeof(Header) ||
+		header.m_FileSize != fileSize)
+	{
+		PrintLogMsg(mh::format("Ignoring damaged or incompatible font atlas cache {}", path.string()));
+		return false;
+	}
+
+	if (header.m_Key != GetFontAtlasCacheKey(atlas))
+	{
+		PrintLogMsg(mh::format("Font atlas cache {} is out of date", path.string()));
+		return false;
+	}
+
+	// The saved rects are the user's ones followed by whatever the builder added
+	if (header.m_FontCount != uint32_t(atlas.Fonts.Size) ||
+		header.m_CustomRectCount < uint32_t(atlas.CustomRects.Size))
+	{
+		return false;
+	}
+
+	const uint64_t pixelsSize = uint64_t(header.m_TexWidth) * uint64_t(header.m_TexHeight) * header.m_BytesPerPixel;
+	const auto IsInBounds = [&](uint64_t offset, uint64_t size) { return offset <= fileSize && size <= fileSize - offset; };
+	if ((header.m_BytesPerPixel != 1 && header.m_BytesPerPixel != 4) ||
+		!IsInBounds(sizeof(Header), uint64_t(header.m_FontCount) * sizeof(FontRecord)) ||
+		!IsInBounds(header.m_CustomRectsOffset, uint64_t(header.m_CustomRectCount) * sizeof(CustomRectRecord)) ||
+		!IsInBounds(header.m_PixelsOffset, pixelsSize))
+	{
+		return false;
+	}
+
+	const auto fontRecords = reinterpret_cast<const FontRecord*>(data + sizeof(Header));
+	for (uint32_t i = 0; i < header.m_FontCount; i++)
+	{
+		if (!IsInBounds(fontRecords[i].m_GlyphsOffset, uint64_t(fontRecords[i].m_GlyphCount) * sizeof(ImFontGlyph)) ||
+			fontRecords[i].m_ConfigDataIndex < 0 ||
+			fontRecords[i].m_ConfigDataIndex + fontRecords[i].m_ConfigDataCount > atlas.ConfigData.Size)
+		{
+			return false;
+		}
+	}
+
+	// Everything checks out, nothing below can fail
+	atlas.ClearTexData();
+
+	if (header.m_BytesPerPixel == 1)
+	{
+		atlas.TexPixelsAlpha8 = static_cast<unsigned char*>(IM_ALLOC(size_t(pixelsSize)));
+		std::memcpy(atlas.TexPixelsAlpha8, data + header.m_PixelsOffset, size_t(pixelsSize));
+	}
+	else
+	{
+		atlas.TexPixelsRGBA32 = static_cast<unsigned int*>(IM_ALLOC(size_t(pixelsSize)));
+		std::memcpy(atlas.TexPixelsRGBA32, data + header.m_PixelsOffset, size_t(pixelsSize));
+	}
+
+	atlas.TexWidth = header.m_TexWidth;
+	atlas.TexHeight = header.m_TexHeight;
+	atlas.TexPixelsUseColors = header.m_TexPixelsUseColors != 0;
+	atlas.TexUvScale = header.m_TexUvScale;
+	atlas.TexUvWhitePixel = header.m_TexUvWhitePixel;
+	std::memcpy(atlas.TexUvLines, header.m_TexUvLines, sizeof(atlas.TexUvLines));
+	atlas.PackIdMouseCursors = header.m_PackIdMouseCursors;
+	atlas.PackIdLines = header.m_PackIdLines;
+
+	// The builder appends its own rects (mouse cursors, lines) after the user's ones
+	const auto rectRecords = reinterpret_cast<const CustomRectRecord*>(data + header.m_CustomRectsOffset);
+	atlas.CustomRects.resize(int(header.m_CustomRectCount));
+	for (uint32_t i = 0; i < header.m_CustomRectCount; i++)
+	{
+		atlas.CustomRects[int(i)] = rectRecords[i].m_Rect;
+		atlas.CustomRects[int(i)].Font = rectRecords[i].m_FontIndex >= 0 ? atlas.Fonts[rectRecords[i].m_FontIndex] : nullptr;
+	}
+
+	for (uint32_t i = 0; i < header.m_FontCount; i++)
+	{
+		const FontRecord& record = fontRecords[i];
+		ImFont& font = *atlas.Fonts[int(i)];
+
+		font.ClearOutputData();
+		font.FontSize = record.m_FontSize;
+		font.Ascent = record.m_Ascent;
+		font.Descent = record.m_Descent;
+		font.Scale = record.m_Scale;
+		font.ContainerAtlas = &atlas;
+		font.ConfigData = &atlas.ConfigData[record.m_ConfigDataIndex];
+		font.ConfigDataCount = short(record.m_ConfigDataCount);
+		font.MetricsTotalSurface = record.m_MetricsTotalSurface;
+		font.FallbackChar = ImWchar(record.m_FallbackChar);
+		font.EllipsisChar = ImWchar(record.m_EllipsisChar);
+
+		font.Glyphs.resize(int(record.m_GlyphCount));
+		if (record.m_GlyphCount > 0)
+			std::memcpy(font.Glyphs.Data, data + record.m_GlyphsOffset, record.m_GlyphCount * sizeof(ImFontGlyph));
+
+		font.BuildLookupTable();
+	}
+
+	atlas.TexReady = true;
+	return true;
+}
+
+bool ImGuiDesktop::SaveFontAtlasCache(const ImFontAtlas& atlas, const std::filesystem::path& path)
+{
+	const uint32_t bytesPerPixel = atlas.TexPixelsAlpha8 ? 1 : 4;
+	const void* pixels = atlas.TexPixelsAlpha8 ? static_cast<const void*>(atlas.TexPixelsAlpha8) : atlas.TexPixelsRGBA32;
+	if (!pixels)
+		return false;
+
+	Header header{};
+	std::memcpy(header.m_Magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.m_FormatVersion = CACHE_FORMAT_VERSION;
+	header.m_HeaderSize = sizeof(Header);
+	header.m_TexWidth = atlas.TexWidth;
+	header.m_TexHeight = atlas.TexHeight;
+	header.m_BytesPerPixel = bytesPerPixel;
+	header.m_TexPixelsUseColors = atlas.TexPixelsUseColors;
+	header.m_TexUvScale = atlas.TexUvScale;
+	header.m_TexUvWhitePixel = atlas.TexUvWhitePixel;
+	std::memcpy(header.m_TexUvLines, atlas.TexUvLines, sizeof(header.m_TexUvLines));
+	header.m_PackIdMouseCursors = atlas.PackIdMouseCursors;
+	header.m_PackIdLines = atlas.PackIdLines;
+	header.m_FontCount = uint32_t(atlas.Fonts.Size);
+	header.m_CustomRectCount = uint32_t(atlas.CustomRects.Size);
+
+	// The key has to describe the atlas as it was before building, which means without the builder's own rects
+	{
+		ImFontAtlas& mutableAtlas = const_cast<ImFontAtlas&>(atlas);
+		const int userRectCount = [&]
+		{
+			int count = atlas.CustomRects.Size;
+			if (atlas.PackIdMouseCursors >= 0)
+				count = std::min(count, atlas.PackIdMouseCursors);
+			if (atlas.PackIdLines >= 0)
+				count = std::min(count, atlas.PackIdLines);
+			return count;
+		}();
+
+		const int fullRectCount = mutableAtlas.CustomRects.Size;
+		mutableAtlas.CustomRects.Size = userRectCount;
+		header.m_Key = GetFontAtlasCacheKey(atlas);
+		mutableAtlas.CustomRects.Size = fullRectCount;
+	}
+
+	uint64_t offset = Align8(sizeof(Header) + uint64_t(header.m_FontCount) * sizeof(FontRecord));
+
+	std::vector<FontRecord> fontRecords(header.m_FontCount);
+	for (uint32_t i = 0; i < header.m_FontCount; i++)
+	{
+		const ImFont& font = *atlas.Fonts[int(i)];
+		FontRecord& record = fontRecords[i];
+		record.m_FontSize = font.FontSize;
+		record.m_Ascent = font.Ascent;
+		record.m_Descent = font.Descent;
+		record.m_Scale = font.Scale;
+		record.m_ConfigDataIndex = FindConfigIndex(atlas, font.ConfigData);
+		record.m_ConfigDataCount = font.ConfigDataCount;
+		record.m_MetricsTotalSurface = font.MetricsTotalSurface;
+		record.m_FallbackChar = font.FallbackChar;
+		record.m_EllipsisChar = font.EllipsisChar;
+		record.m_GlyphCount = uint32_t(font.Glyphs.Size);
+		record.m_GlyphsOffset = offset;
+		offset = Align8(offset + record.m_GlyphCount * sizeof(ImFontGlyph));
+
+		if (record.m_ConfigDataIndex < 0)
+			return false;
+	}
+
+	std::vector<CustomRectRecord> rectRecords(header.m_CustomRectCount);
+	for (uint32_t i = 0; i < header.m_CustomRectCount; i++)
+	{
+		rectRecords[i].m_Rect = atlas.CustomRects[int(i)];
+		rectRecords[i].m_Rect.Font = nullptr;
+		rectRecords[i].m_FontIndex = FindFontIndex(atlas, atlas.CustomRects[int(i)].Font);
+	}
+
+	header.m_CustomRectsOffset = offset;
+	offset = Align8(offset + rectRecords.size() * sizeof(CustomRectRecord));
+
+	const uint64_t pixelsSize = uint64_t(atlas.TexWidth) * uint64_t(atlas.TexHeight) * bytesPerPixel;
+	header.m_PixelsOffset = offset;
+	header.m_FileSize = offset + pixelsSize;
+
+	// Write to a temporary file and swap it in, so a crash or a second instance never sees half a cache
+	auto tempPath = path;
+	tempPath += ".tmp";
+
+	{
+		std::error_code ec;
+		if (path.has_parent_path())
+			std::filesystem::create_directories(path.parent_path(), ec);
+
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			PrintLogMsg(mh::format("Failed to open {} for writing the font atlas cache", tempPath.string()));
+			return false;
+		}
+
+		const auto WritePadded = [&](const void* src, uint64_t size)
+		{
+			static constexpr char PADDING[8]{};
+			file.write(static_cast<const char*>(src), std::streamsize(size));
+			file.write(PADDING, std::streamsize(Align8(size) - size));
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WritePadded(fontRecords.data(), fontRecords.size() * sizeof(FontRecord));
+
+		for (uint32_t i = 0; i < header.m_FontCount; i++)
+			WritePadded(atlas.Fonts[int(i)]->Glyphs.Data, uint64_t(atlas.Fonts[int(i)]->Glyphs.Size) * sizeof(ImFontGlyph));
+
+		WritePadded(rectRecords.data(), rectRecords.size() * sizeof(CustomRectRecord));
+		file.write(static_cast<const char*>(pixels), std::streamsize(pixelsSize));
+
+		if (!file)
+		{
+			PrintLogMsg(mh::format("Failed to write font atlas cache to {}", tempPath.string()));
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec)
+	{
+		PrintLogMsg(mh::format("Failed to replace font atlas cache {}: {}", path.string(), ec.message()));
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
+}
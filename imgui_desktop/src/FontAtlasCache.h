@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+struct ImFontAtlas;
+
+namespace ImGuiDesktop
+{
+	// Hash of everything that goes into baking the atlas: font data, sizes, glyph ranges,
+	// oversampling and other config, custom rects and the imgui version
+	uint64_t GetFontAtlasCacheKey(const ImFontAtlas& atlas);
+
+	// Restores a previously baked atlas (pixels, glyph tables, custom rect positions) into an atlas
+	// that has had all of its fonts added but hasn't been built yet. Returns false, leaving the atlas
+	// untouched, if the file is missing, damaged or was baked from different inputs.
+	bool LoadFontAtlasCache(ImFontAtlas& atlas, const std::filesystem::path& path);
+
+	// Atlas must be built
+	bool SaveFontAtlasCache(const ImFontAtlas& atlas, const std::filesystem::path& path);
+}
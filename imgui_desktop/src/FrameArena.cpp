@@ -0,0 +1,68 @@
+#include "Allocation.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ImGuiDesktop;
+
+FrameArena::~FrameArena() = default;
+
+std::string_view FrameArena::CopyString(const std::string_view& str)
+{
+	auto dst = static_cast<char*>(allocate(str.size() + 1, alignof(char)));
+	std::memcpy(dst, str.data(), str.size());
+	dst[str.size()] = '\0';
+	return std::string_view(dst, str.size());
+}
+
+void FrameArena::Reset()
+{
+	// Replace the chunks with a single one big enough for all of them, so the next frame
+	// (if it's anything like this one) fits without allocating
+	if (m_Chunks.size() > 1)
+	{
+		const size_t capacity = GetCapacity();
+		m_Chunks.clear();
+		m_Chunks.push_back({ std::make_unique_for_overwrite<std::byte[]>(capacity), capacity });
+	}
+
+	m_CurrentChunk = 0;
+	m_Offset = 0;
+	m_BytesUsed = 0;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+	size_t capacity = 0;
+	for (const Chunk& chunk : m_Chunks)
+		capacity += chunk.m_Size;
+
+	return capacity;
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+	while (m_CurrentChunk < m_Chunks.size())
+	{
+		Chunk& chunk = m_Chunks[m_CurrentChunk];
+
+		void* ptr = chunk.m_Data.get() + m_Offset;
+		size_t space = chunk.m_Size - m_Offset;
+		if (std::align(alignment, bytes, ptr, space))
+		{
+			m_Offset = chunk.m_Size - space + bytes;
+			m_BytesUsed += bytes;
+			return ptr;
+		}
+
+		m_CurrentChunk++;
+		m_Offset = 0;
+	}
+
+	const size_t lastSize = m_Chunks.empty() ? 0 : m_Chunks.back().m_Size;
+	const size_t size = std::max({ MIN_CHUNK_SIZE, lastSize * 2, bytes + alignment });
+	m_Chunks.push_back({ std::make_unique_for_overwrite<std::byte[]>(size), size });
+	m_CurrentChunk = m_Chunks.size() - 1;
+
+	return do_allocate(bytes, alignment);
+}
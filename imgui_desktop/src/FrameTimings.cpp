@@ -0,0 +1,142 @@
+#include "FrameTimings.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace ImGuiDesktop;
+
+const char* ImGuiDesktop::GetFramePhaseName(FramePhase phase)
+{
+	switch (phase)
+	{
+	case FramePhase::EventPump:      return "EventPump";
+	case FramePhase::Update:         return "Update";
+	case FramePhase::PreDraw:        return "PreDraw";
+	case FramePhase::Draw:           return "Draw";
+	case FramePhase::ImGuiRender:    return "ImGuiRender";
+	case FramePhase::RenderDrawData: return "RenderDrawData";
+	case FramePhase::Swap:           return "Swap";
+	case FramePhase::EndFrame:       return "EndFrame";
+
+	default:
+		assert(!"Unknown FramePhase");
+		return "<unknown>";
+	}
+}
+
+const char* ImGuiDesktop::GetFramePhaseName(GPUFramePhase phase)
+{
+	switch (phase)
+	{
+	case GPUFramePhase::RenderDrawData: return "GPU RenderDrawData";
+	case GPUFramePhase::Swap:           return "GPU Swap";
+
+	default:
+		assert(!"Unknown GPUFramePhase");
+		return "<unknown>";
+	}
+}
+
+void FrameTimingHistory::Push(const FrameTimingSample& sample)
+{
+	m_Samples[m_Next] = sample;
+	m_Next = (m_Next + 1) % CAPACITY;
+	m_Count = std::min(m_Count + 1, CAPACITY);
+}
+
+void FrameTimingHistory::Clear()
+{
+	m_Next = 0;
+	m_Count = 0;
+}
+
+const FrameTimingSample& FrameTimingHistory::GetSample(size_t index) const
+{
+	assert(index < m_Count);
+	return m_Samples[(m_Next + CAPACITY - m_Count + index) % CAPACITY];
+}
+
+FrameTimingSample* FrameTimingHistory::FindSample(uint64_t frameIndex)
+{
+	if (m_Count == 0)
+		return nullptr;
+
+	// Frame indices are consecutive, so this is just an offset from the newest one
+	const auto& newest = GetSample(m_Count - 1);
+	if (frameIndex > newest.m_FrameIndex || newest.m_FrameIndex - frameIndex >= m_Count)
+		return nullptr;
+
+	auto& sample = const_cast<FrameTimingSample&>(GetSample(m_Count - 1 - size_t(newest.m_FrameIndex - frameIndex)));
+	return sample.m_FrameIndex == frameIndex ? &sample : nullptr;
+}
+
+size_t FrameTimingHistory::CopySamples(std::span<FrameTimingSample> dst) const
+{
+	const size_t count = std::min(dst.size(), m_Count);
+	for (size_t i = 0; i < count; i++)
+		dst[i] = GetSample(m_Count - count + i);
+
+	return count;
+}
+
+FrameTimingStats FrameTimingHistory::GetStats(FramePhase phase, size_t frameCount) const
+{
+	return ComputeStats(frameCount, [phase](const FrameTimingSample& sample) -> std::optional<float> { return sample.GetPhaseMS(phase); });
+}
+
+FrameTimingStats FrameTimingHistory::GetTotalStats(size_t frameCount) const
+{
+	return ComputeStats(frameCount, [](const FrameTimingSample& sample) -> std::optional<float> { return sample.m_TotalMS; });
+}
+
+FrameTimingStats FrameTimingHistory::GetStats(GPUFramePhase phase, size_t frameCount) const
+{
+	return ComputeStats(frameCount, [phase](const FrameTimingSample& sample) -> std::optional<float>
+		{
+			if (!sample.m_HasGPUTimings)
+				return std::nullopt;
+
+			return sample.GetPhaseMS(phase);
+		});
+}
+
+template<typename TFunc>
+FrameTimingStats FrameTimingHistory::ComputeStats(size_t frameCount, const TFunc& getValue) const
+{
+	FrameTimingStats stats;
+	frameCount = std::min(frameCount, m_Count);
+
+	std::array<float, CAPACITY> values;
+	double sum = 0;
+	for (size_t i = 0; i < frameCount; i++)
+	{
+		if (const std::optional<float> value = getValue(GetSample(m_Count - frameCount + i)))
+		{
+			values[stats.m_SampleCount++] = *value;
+			sum += *value;
+		}
+	}
+
+	if (stats.m_SampleCount == 0)
+		return stats;
+
+	const auto begin = values.begin();
+	const auto end = values.begin() + stats.m_SampleCount;
+	std::sort(begin, end);
+
+	// Nearest-rank percentiles
+	const auto GetPercentile = [&](double percentile)
+	{
+		const auto rank = size_t(std::ceil(percentile / 100 * double(stats.m_SampleCount)));
+		return values[std::clamp<size_t>(rank, 1, stats.m_SampleCount) - 1];
+	};
+
+	stats.m_Min = values[0];
+	stats.m_Max = values[stats.m_SampleCount - 1];
+	stats.m_Avg = float(sum / double(stats.m_SampleCount));
+	stats.m_P50 = GetPercentile(50);
+	stats.m_P95 = GetPercentile(95);
+	stats.m_P99 = GetPercentile(99);
+	return stats;
+}
@@ -0,0 +1,110 @@
+#include "Framebuffer.h"
+#include "ImGuiDesktopInternal.h"
+
+#ifdef IMGUI_USE_GLAD2
+#include <glad/gl.h>
+#else
+#error fixme
+#endif
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+using namespace ImGuiDesktop;
+using namespace std::string_literals;
+
+Framebuffer::~Framebuffer()
+{
+	Destroy();
+}
+
+bool Framebuffer::Resize(uint32_t width, uint32_t height)
+{
+	if (m_FBO && width == m_Width && height == m_Height)
+		return false;
+
+	Destroy();
+
+	m_Width = width;
+	m_Height = height;
+
+	GLint prevTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &prevTexture);
+
+	glGenTextures(1, &m_Texture);
+	glBindTexture(GL_TEXTURE_2D, m_Texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GLsizei(width), GLsizei(height), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindTexture(GL_TEXTURE_2D, GLuint(prevTexture));
+
+	glGenFramebuffers(1, &m_FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_Texture, 0);
+
+	if (auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE)
+		PrintLogMsg("Offscreen framebuffer incomplete, status "s << status);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return true;
+}
+
+void Framebuffer::Bind() const
+{
+	assert(m_FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+}
+
+void Framebuffer::BindDefault()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::BlitToDefault() const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glDisable(GL_SCISSOR_TEST);
+	glBlitFramebuffer(0, 0, GLint(m_Width), GLint(m_Height), 0, 0, GLint(m_Width), GLint(m_Height),
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::ReadPixels(void* dst) const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, GLsizei(m_Width), GLsizei(m_Height), GL_RGBA, GL_UNSIGNED_BYTE, dst);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// GL hands us the bottom row first
+	const size_t rowSize = size_t(m_Width) * 4;
+	std::vector<uint8_t> tempRow(rowSize);
+	auto rows = static_cast<uint8_t*>(dst);
+	for (uint32_t top = 0, bottom = m_Height - 1; top < bottom; top++, bottom--)
+	{
+		std::memcpy(tempRow.data(), rows + top * rowSize, rowSize);
+		std::memcpy(rows + top * rowSize, rows + bottom * rowSize, rowSize);
+		std::memcpy(rows + bottom * rowSize, tempRow.data(), rowSize);
+	}
+}
+
+void Framebuffer::Destroy()
+{
+	if (m_FBO)
+	{
+		glDeleteFramebuffers(1, &m_FBO);
+		m_FBO = 0;
+	}
+
+	if (m_Texture)
+	{
+		glDeleteTextures(1, &m_Texture);
+		m_Texture = 0;
+	}
+
+	m_Width = m_Height = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <cstdint>
+
+namespace ImGuiDesktop
+{
+	// Offscreen RGBA8 color target. Requires OpenGL 3.0 (or ARB_framebuffer_object), and the
+	// owning GL context must be current whenever any member, including the destructor, is called.
+	class Framebuffer final : mh::disable_copy_move
+	{
+	public:
+		Framebuffer() = default;
+		~Framebuffer();
+
+		// Returns true if the storage was (re)created, meaning the previous contents are gone
+		bool Resize(uint32_t width, uint32_t height);
+
+		void Bind() const;
+		static void BindDefault();
+
+		// Copies the whole framebuffer to the same position in the default framebuffer
+		void BlitToDefault() const;
+
+		// Tightly packed RGBA8, top row first. dst must hold width * height * 4 bytes.
+		void ReadPixels(void* dst) const;
+
+		uint32_t GetWidth() const { return m_Width; }
+		uint32_t GetHeight() const { return m_Height; }
+		uint32_t GetTexture() const { return m_Texture; }
+
+	private:
+		void Destroy();
+
+		uint32_t m_FBO = 0;
+		uint32_t m_Texture = 0;
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+	};
+}
@@ -0,0 +1,72 @@
+#include "GLCapabilities.h"
+
+#ifdef IMGUI_USE_GLAD2
+#include <glad/gl.h>
+#else
+#error fixme
+#endif
+
+using namespace ImGuiDesktop;
+
+namespace
+{
+	std::string GetGLString(GLenum name)
+	{
+		const auto str = reinterpret_cast<const char*>(glGetString(name));
+		return str ? str : "";
+	}
+}
+
+GLCapabilities GLCapabilities::Query(GLContextVersion version)
+{
+	GLCapabilities caps;
+	caps.m_Version = version;
+	caps.m_Vendor = GetGLString(GL_VENDOR);
+	caps.m_Renderer = GetGLString(GL_RENDERER);
+	caps.m_VersionString = GetGLString(GL_VERSION);
+
+	if (version.m_Major >= 3 && glGetStringi)
+	{
+		GLint extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+		caps.m_Extensions.reserve(size_t(extensionCount));
+
+		for (GLint i = 0; i < extensionCount; i++)
+		{
+			if (auto ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i))))
+				caps.m_Extensions.emplace(ext);
+		}
+	}
+	else
+	{
+		// glGetStringi doesn't exist before 3.0, and GL_EXTENSIONS is gone from core profiles after it
+		const std::string extensions = GetGLString(GL_EXTENSIONS);
+		for (size_t start = 0; start < extensions.size(); )
+		{
+			size_t end = extensions.find(' ', start);
+			if (end == std::string::npos)
+				end = extensions.size();
+
+			if (end > start)
+				caps.m_Extensions.emplace(extensions, start, end - start);
+
+			start = end + 1;
+		}
+	}
+
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &caps.m_MaxTextureSize);
+
+	const auto Has = [&](GLContextVersion coreVersion, const std::string_view& extension)
+	{
+		return version >= coreVersion || caps.HasExtension(extension);
+	};
+
+	caps.m_HasFramebufferObjects = Has(GLContextVersion(3, 0), "GL_ARB_framebuffer_object");
+	caps.m_HasSync = Has(GLContextVersion(3, 2), "GL_ARB_sync");
+	caps.m_HasDrawBaseVertex = Has(GLContextVersion(3, 2), "GL_ARB_draw_elements_base_vertex");
+	caps.m_HasTimerQuery = Has(GLContextVersion(3, 3), "GL_ARB_timer_query");
+	caps.m_HasBufferStorage = Has(GLContextVersion(4, 4), "GL_ARB_buffer_storage");
+	caps.m_HasDebugOutput = Has(GLContextVersion(4, 3), "GL_KHR_debug") || caps.HasExtension("GL_ARB_debug_output");
+
+	return caps;
+}
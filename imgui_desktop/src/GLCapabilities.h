@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GLContextVersion.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace ImGuiDesktop
+{
+	// Everything we want to know about a context, queried once when it's created.
+	// Lookups never call into GL, so they work (and are cheap) with or without a current context.
+	class GLCapabilities
+	{
+	public:
+		// The context must be current and GL function pointers loaded
+		static GLCapabilities Query(GLContextVersion version);
+
+		bool HasExtension(const std::string_view& extensionName) const { return m_Extensions.contains(extensionName); }
+		size_t GetExtensionCount() const { return m_Extensions.size(); }
+
+		GLContextVersion GetVersion() const { return m_Version; }
+		const std::string& GetVendor() const { return m_Vendor; }
+		const std::string& GetRenderer() const { return m_Renderer; }
+		const std::string& GetVersionString() const { return m_VersionString; }
+
+		int32_t GetMaxTextureSize() const { return m_MaxTextureSize; }
+
+		bool HasFramebufferObjects() const { return m_HasFramebufferObjects; }   // GL 3.0 or ARB_framebuffer_object
+		bool HasSync() const { return m_HasSync; }                               // GL 3.2 or ARB_sync
+		bool HasDrawBaseVertex() const { return m_HasDrawBaseVertex; }           // GL 3.2 or ARB_draw_elements_base_vertex
+		bool HasTimerQuery() const { return m_HasTimerQuery; }                   // GL 3.3 or ARB_timer_query
+		bool HasBufferStorage() const { return m_HasBufferStorage; }             // GL 4.4 or ARB_buffer_storage
+		bool HasDebugOutput() const { return m_HasDebugOutput; }                 // GL 4.3, KHR_debug or ARB_debug_output
+
+	private:
+		struct StringHash
+		{
+			using is_transparent = void;
+			size_t operator()(const std::string_view& str) const { return std::hash<std::string_view>{}(str); }
+		};
+
+		GLContextVersion m_Version;
+		std::string m_Vendor;
+		std::string m_Renderer;
+		std::string m_VersionString;
+		std::unordered_set<std::string, StringHash, std::equal_to<>> m_Extensions;
+
+		int32_t m_MaxTextureSize = 0;
+
+		bool m_HasFramebufferObjects = false;
+		bool m_HasSync = false;
+		bool m_HasDrawBaseVertex = false;
+		bool m_HasTimerQuery = false;
+		bool m_HasBufferStorage = false;
+		bool m_HasDebugOutput = false;
+	};
+}
@@ -1,4 +1,6 @@
 #include "GLContext.h"
+#include "Application.h"
+#include "GLProbeCache.h"
 #include "ImGuiDesktopInternal.h"
 
 #include <mh/algorithm/algorithm.hpp>
@@ -6,7 +8,10 @@
 #include <mh/text/format.hpp>
 #include <SDL.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <optional>
 #include <sstream>
 
 #ifdef IMGUI_USE_GLBINDING
@@ -129,17 +134,137 @@ static void InstallDebugCallback(const GLContextScope& context)
 
 namespace
 {
+	// What SDL_GL_MakeCurrent last bound on this thread. Scopes leave the context bound when they
+	// exit, so entering another one for the same window and context doesn't have to rebind it.
+	struct CurrentBinding
+	{
+		~CurrentBinding() { ReleaseLingering(); }
+
+		// Drops the lock on a context left bound here once it isn't anymore
+		void ReleaseLingering()
+		{
+			if (m_LingeringLock.owns_lock())
+				m_LingeringLock.unlock();
+
+			// Before the context (and its mutex) can go away
+			m_LingeringLock = {};
+			auto context = std::move(m_LingeringContext);
+		}
+
+		void Reset()
+		{
+			m_Window = nullptr;
+			m_Context = nullptr;
+			ReleaseLingering();
+		}
+
+		SDL_Window* m_Window = nullptr;
+		void* m_Context = nullptr;
+
+		// While a context stays bound here with no scope open, this thread keeps it locked. Another
+		// thread can only enter a scope for it once it's been unbound here, instead of failing to
+		// make it current while it's still current on this thread.
+		std::shared_ptr<GLContext> m_LingeringContext;
+		std::unique_lock<std::recursive_mutex> m_LingeringLock;
+	};
+	thread_local CurrentBinding t_CurrentBinding;
+
+	std::atomic<uint64_t> s_MakeCurrentCount = 0;
+	std::atomic<uint64_t> s_SkippedMakeCurrentCount = 0;
+
+	bool MakeCurrent(SDL_Window* window, void* context)
+	{
+		if (t_CurrentBinding.m_Window == window && t_CurrentBinding.m_Context == context)
+		{
+			s_SkippedMakeCurrentCount.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		s_MakeCurrentCount.fetch_add(1, std::memory_order_relaxed);
+		if (SDL_GL_MakeCurrent(window, context) != 0)
+		{
+			t_CurrentBinding.Reset();
+			return SDL_PRINT_AND_CLEAR_ERROR();
+		}
+
+		// Same context on another window is still the same lingering context
+		if (t_CurrentBinding.m_Context != context)
+			t_CurrentBinding.ReleaseLingering();
+
+		t_CurrentBinding.m_Window = window;
+		t_CurrentBinding.m_Context = context;
+		return true;
+	}
+
+	// SDL_GL_CreateContext makes the new context current behind our back
+	SDL_GLContext CreateSDLGLContext(SDL_Window* window)
+	{
+		t_CurrentBinding.Reset();
+		return SDL_GL_CreateContext(window);
+	}
+
 	struct SDL_GLContextDeleter
 	{
 		void operator()(void* context) const
 		{
+			// Never the lingering context, that one can't be deleted while it's still referenced
+			if (t_CurrentBinding.m_Context == context)
+			{
+				t_CurrentBinding.m_Window = nullptr;
+				t_CurrentBinding.m_Context = nullptr;
+			}
+
 			SDL_GL_DeleteContext(context);
 		}
 	};
 
+	// Core profile for anything that has one, legacy context otherwise
+	std::shared_ptr<GLContext> TryCreateContext(SDL_Window* window, GLContextVersion version)
+	{
+		PrintLogMsg(mh::format("Initializing OpenGL {}...", version));
+		SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, version.m_Major));
+		SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, version.m_Minor));
+
+		if (version >= GLContextVersion(3, 2))
+		{
+			SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE));
+		}
+		else
+		{
+			// These must be set back to zero for legacy context creation
+			SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, 0));
+			SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0));
+		}
+
+		auto context = std::make_shared<GLContext>(
+			std::shared_ptr<void>(CreateSDLGLContext(window), SDL_GLContextDeleter{}),
+			version);
+
+		if (!SDL_PRINT_AND_CLEAR_ERROR())
+			return nullptr;
+
+		GLContextScope scope(window, context);
+
+#ifdef IMGUI_USE_GLAD2
+		gladLoadGL([](const char* name) __declspec(noinline)
+			{
+				return reinterpret_cast<GLADapiproc>(SDL_GL_GetProcAddress(name));
+			});
+#endif
+
+		context->QueryCapabilities();
+		return context;
+	}
+
+	GLProbeCache GetProbeResult(const GLContext& context)
+	{
+		const GLCapabilities& caps = context.GetCapabilities();
+		return GLProbeCache{ context.GetVersion(), caps.GetVendor(), caps.GetRenderer(), caps.GetVersionString() };
+	}
+
 	struct GLContextHolder
 	{
-		std::shared_ptr<GLContext> GetOrCreateGLContext(SDL_Window* window)
+		std::shared_ptr<GLContext> GetOrCreateGLContext(SDL_Window* window, const GLContextProbeSettings& settings)
 		{
 			auto context = m_GLContext.lock();
 			if (!context)
@@ -149,96 +274,111 @@ namespace
 				context = m_GLContext.lock();
 				if (!context)
 				{
-					constexpr GLContextVersion VERSION_4(4, 3);
-					constexpr GLContextVersion VERSION_3(3, 2);
-					constexpr GLContextVersion VERSION_2(2, 0);
+					context = CreateContext(window, settings);
 
-#if IMGUI_USE_OPENGL3
-					// Try OpenGL 4
 					{
-						PrintLogMsg(mh::format("Initializing OpenGL {}...", VERSION_4));
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, VERSION_4.m_Major));
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, VERSION_4.m_Minor));
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE));
-						context = std::make_shared<GLContext>(
-							std::shared_ptr<void>(SDL_GL_CreateContext(window), SDL_GLContextDeleter{}),
-							VERSION_4);
-
-						if (!SDL_PRINT_AND_CLEAR_ERROR())
-							context.reset();
+						GLContextScope scope(window, context);
+						InstallDebugCallback(scope);
 					}
 
-					if (!context)
-					{
-						// Try OpenGL 3
-						PrintLogMsg(mh::format("Initializing OpenGL {}...", VERSION_3));
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, VERSION_3.m_Major));
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, VERSION_3.m_Minor));
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE));
-						context = std::make_shared<GLContext>(
-							std::shared_ptr<void>(SDL_GL_CreateContext(window), SDL_GLContextDeleter{}),
-							VERSION_3);
-
-						if (!SDL_PRINT_AND_CLEAR_ERROR())
-							context.reset();
-					}
-#endif
+					m_GLContext = context;
+				}
+			}
 
-					if (!context)
-					{
-						// Try OpenGL 2
-						PrintLogMsg(mh::format("Initializing OpenGL {}...", VERSION_2));
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, VERSION_2.m_Major));
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, VERSION_2.m_Minor));
+			return context;
+		}
 
-						// These must be set back to zero for legacy context creation
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, 0));
-						SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0));
+		std::shared_ptr<GLContext> CreateWorkerContext(SDL_Window* window)
+		{
+			std::lock_guard lock(m_Mutex);
 
-						context = std::make_shared<GLContext>(
-							std::shared_ptr<void>(SDL_GL_CreateContext(window), SDL_GLContextDeleter{}),
-							VERSION_2);
+			const auto mainContext = m_GLContext.lock();
+			if (!mainContext)
+				return nullptr;
 
-						if (!SDL_PRINT_AND_CLEAR_ERROR())
-							context.reset();
-					}
+			GLContextScope scope(window, mainContext);
+			return scope.CreateSharedContext();
+		}
 
-					if (!context)
-					{
-						// Nothing worked, show an error and quit
-						std::stringstream ss;
-						ss << "Failed to initialize OpenGL " << VERSION_4
-							<< ", OpenGL " << VERSION_3
-							<< ", or OpenGL " << VERSION_2
-							<< ". Unfortunately, this means your computer is too old to run this software.";
+	private:
+		static bool IsVersionUsable(GLContextVersion version)
+		{
+#if IMGUI_USE_OPENGL3
+			return true;
+#else
+			return version.m_Major < 3;
+#endif
+		}
 
-						SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "OpenGL Initialization Failed",
-							ss.str().c_str(), window);
+		static std::shared_ptr<GLContext> CreateContext(SDL_Window* window, const GLContextProbeSettings& settings)
+		{
+			std::shared_ptr<GLContext> context;
 
-						std::exit(1);
-					}
+			// Go straight for whatever worked last time. If the driver changed since then, a better
+			// version might work now, so throw the context away and probe everything again.
+			std::optional<GLProbeCache> cache;
+			if (!settings.m_CachePath.empty())
+				cache = LoadGLProbeCache(settings.m_CachePath);
 
-					{
-						GLContextScope scope(window, context);
+			std::optional<GLContextVersion> failedVersion;
+			if (cache && IsVersionUsable(cache->m_Version) &&
+				std::find(settings.m_Versions.begin(), settings.m_Versions.end(), cache->m_Version) != settings.m_Versions.end())
+			{
+				context = TryCreateContext(window, cache->m_Version);
+				if (!context)
+				{
+					failedVersion = cache->m_Version;
+				}
+				else if (!GetProbeResult(*context).IsSameDriver(*cache))
+				{
+					PrintLogMsg("OpenGL driver changed since the last launch, probing all context versions");
+					context.reset();
+				}
+			}
 
-#ifdef IMGUI_USE_GLAD2
-						gladLoadGL([](const char* name) __declspec(noinline)
-							{
-								return reinterpret_cast<GLADapiproc>(SDL_GL_GetProcAddress(name));
-							});
-#endif
+			if (!context)
+			{
+				for (const GLContextVersion& version : settings.m_Versions)
+				{
+					if (!IsVersionUsable(version) || version == failedVersion)
+						continue;
 
-						InstallDebugCallback(scope);
-					}
+					context = TryCreateContext(window, version);
+					if (context)
+						break;
+				}
+			}
 
-					m_GLContext = context;
+			if (!context)
+			{
+				// Nothing worked, show an error and quit
+				std::stringstream ss;
+				ss << "Failed to initialize OpenGL";
+				for (size_t i = 0; i < settings.m_Versions.size(); i++)
+				{
+					if (i > 0)
+						ss << (i + 1 == settings.m_Versions.size() ? ", or" : ",");
+
+					ss << " OpenGL " << settings.m_Versions[i];
 				}
+				ss << ". Unfortunately, this means your computer is too old to run this software.";
+
+				SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "OpenGL Initialization Failed",
+					ss.str().c_str(), window);
+
+				std::exit(1);
+			}
+
+			if (!settings.m_CachePath.empty())
+			{
+				const GLProbeCache result = GetProbeResult(*context);
+				if (!cache || cache->m_Version != result.m_Version || !cache->IsSameDriver(result))
+					SaveGLProbeCache(result, settings.m_CachePath);
 			}
 
 			return context;
 		}
 
-	private:
 		std::mutex m_Mutex;
 		std::weak_ptr<GLContext> m_GLContext;
 
@@ -246,61 +386,123 @@ namespace
 }
 
 GLContextScope::GLContextScope(SDL_Window* window, const std::shared_ptr<GLContext>& context) :
+	m_Window(window),
 	m_Context(context),
 	m_ContextActiveLock(m_Context->m_ActiveMutex)
 {
 	assert(m_Context->m_RecursionDepth >= 0);
 	if (m_Context->m_RecursionDepth++ <= 0)
 	{
-		if (auto err = SDL_GL_MakeCurrent(window, context->m_InnerContext.get()); err != 0)
-		{
-			if (!SDL_PRINT_AND_CLEAR_ERROR())
-				assert(false);
-		}
+		if (!MakeCurrent(window, context->m_InnerContext.get()))
+			assert(false);
 	}
 }
 
 GLContextScope::~GLContextScope()
 {
-	if (--m_Context->m_RecursionDepth == 0)
+	assert(m_Context->m_RecursionDepth > 0);
+	if (--m_Context->m_RecursionDepth > 0)
+		return;
+
+	// Stays bound until something else is bound on this thread, or ReleaseCurrent(). Until then, this
+	// thread holds on to the mutex so no other thread can take the context while it's still current here.
+	if (t_CurrentBinding.m_Context == m_Context->m_InnerContext.get() && t_CurrentBinding.m_LingeringContext != m_Context)
 	{
-		if (auto err = SDL_GL_MakeCurrent(nullptr, nullptr); err != 0)
-		{
-			if (!SDL_PRINT_AND_CLEAR_ERROR())
-				assert(false);
-		}
+		t_CurrentBinding.ReleaseLingering();
+		t_CurrentBinding.m_LingeringLock = std::unique_lock(m_Context->m_ActiveMutex);
+		t_CurrentBinding.m_LingeringContext = m_Context;
 	}
+}
 
-	assert(m_Context->m_RecursionDepth >= 0);
+void GLContextScope::ReleaseCurrent()
+{
+	if (!t_CurrentBinding.m_Context)
+		return;
+
+	s_MakeCurrentCount.fetch_add(1, std::memory_order_relaxed);
+	if (SDL_GL_MakeCurrent(nullptr, nullptr) != 0)
+		SDL_PRINT_AND_CLEAR_ERROR();
+
+	t_CurrentBinding.Reset();
 }
 
-void* GLContextScope::GetProcAddress(const char* symbolName) const
+void GLContextScope::ReleaseWindow(SDL_Window* window)
 {
-	return SDL_GL_GetProcAddress(symbolName);
+	if (t_CurrentBinding.m_Window == window)
+		ReleaseCurrent();
 }
 
-bool GLContextScope::HasExtension(const std::string_view& extensionName) const
+GLContextSwitchStats ImGuiDesktop::GetGLContextSwitchStats()
 {
-	LOOKUP_GL_SYMBOL(*this, glGetStringi);
+	GLContextSwitchStats stats;
+	stats.m_SwitchCount = s_MakeCurrentCount.load(std::memory_order_relaxed);
+	stats.m_SkippedCount = s_SkippedMakeCurrentCount.load(std::memory_order_relaxed);
+	return stats;
+}
 
-	GLint extensionCount;
-	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
-	for (GLint i = 0; i < extensionCount; i++)
+bool GLContextScope::SetSwapInterval(int interval)
+{
+	if (m_Context->m_SwapIntervalWindow == m_Window && m_Context->m_SwapInterval == interval)
+		return true;
+
+	if (SDL_GL_SetSwapInterval(interval) != 0)
 	{
-		const auto ext = std::string_view(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)));
-		if (extensionName == ext)
-			return true;
+		SDL_PRINT_AND_CLEAR_ERROR();
+		m_Context->m_SwapIntervalWindow = nullptr;
+		return false;
 	}
 
-	return false;
+	m_Context->m_SwapIntervalWindow = m_Window;
+	m_Context->m_SwapInterval = interval;
+	return true;
 }
 
-std::shared_ptr<GLContext> ImGuiDesktop::GetOrCreateGLContext(SDL_Window* window)
+std::shared_ptr<GLContext> GLContextScope::CreateSharedContext() const
 {
-	return s_GLContextHolder.GetOrCreateGLContext(window);
+	const auto version = GetVersion();
+	SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, version.m_Major));
+	SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, version.m_Minor));
+	SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, version >= GLContextVersion(3, 2) ? SDL_GL_CONTEXT_PROFILE_CORE : 0));
+	SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1));
+
+	std::shared_ptr<void> innerContext(CreateSDLGLContext(m_Window), SDL_GLContextDeleter{});
+	const bool success = SDL_PRINT_AND_CLEAR_ERROR() && innerContext.get();
+
+	SDL_TRY_SET_ATTR(SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0));
+
+	// SDL_GL_CreateContext made the new context current, but we're still inside this scope
+	MakeCurrent(m_Window, m_Context->m_InnerContext.get());
+
+	if (!success)
+		return nullptr;
+
+	auto context = std::make_shared<GLContext>(innerContext, version);
+	context->m_Capabilities = m_Context->m_Capabilities;
+	return context;
+}
+
+void* GLContextScope::GetProcAddress(const char* symbolName) const
+{
+	return SDL_GL_GetProcAddress(symbolName);
+}
+
+std::shared_ptr<GLContext> ImGuiDesktop::GetOrCreateGLContext(SDL_Window* window, const GLContextProbeSettings& settings)
+{
+	return s_GLContextHolder.GetOrCreateGLContext(window, settings);
+}
+
+std::shared_ptr<GLContext> ImGuiDesktop::CreateGLWorkerContext(SDL_Window* window)
+{
+	return s_GLContextHolder.CreateWorkerContext(window);
 }
 
 GLContext::GLContext(const std::shared_ptr<void>& context, GLContextVersion version) :
 	m_InnerContext(context), m_GLVersion(version)
 {
 }
+
+void GLContext::QueryCapabilities()
+{
+	assert(!m_Capabilities);
+	m_Capabilities = std::make_shared<const GLCapabilities>(GLCapabilities::Query(m_GLVersion));
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "GLCapabilities.h"
 #include "GLContextVersion.h"
 
 #include <memory>
@@ -10,12 +11,19 @@ struct SDL_Window;
 
 namespace ImGuiDesktop
 {
+	struct GLContextProbeSettings;
+	struct GLContextSwitchStats;
+
 	class GLContext
 	{
 	public:
 		GLContext(const std::shared_ptr<void>& context, GLContextVersion version);
 
 		GLContextVersion GetVersion() const { return m_GLVersion; }
+		const GLCapabilities& GetCapabilities() const { return *m_Capabilities; }
+
+		// Called once right after creation, with the context current and GL loaded
+		void QueryCapabilities();
 
 	private:
 		friend class GLContextScope;
@@ -24,10 +32,20 @@ namespace ImGuiDesktop
 		std::recursive_mutex m_ActiveMutex;
 		int m_RecursionDepth = 0;
 
+		// Depending on the platform, the swap interval belongs to either the context or the drawable
+		SDL_Window* m_SwapIntervalWindow = nullptr;
+		int m_SwapInterval = 0;
+
 		GLContextVersion m_GLVersion{};
+		std::shared_ptr<const GLCapabilities> m_Capabilities; // Shared contexts share the same driver, so the same table
 	};
 
-	std::shared_ptr<GLContext> GetOrCreateGLContext(SDL_Window* window);
+	std::shared_ptr<GLContext> GetOrCreateGLContext(SDL_Window* window, const GLContextProbeSettings& settings);
+	// Another context sharing objects with the one from GetOrCreateGLContext(), for a worker thread. Main
+	// thread only, with no GLContextScope active. The main context is left current on window, which can be
+	// any (hidden) window. Returns nullptr if there is no main context yet, or creating one failed.
+	std::shared_ptr<GLContext> CreateGLWorkerContext(SDL_Window* window);
+	GLContextSwitchStats GetGLContextSwitchStats();
 	void SetupBasicWindowAttributes();
 
 	class GLContextScope
@@ -37,12 +55,30 @@ namespace ImGuiDesktop
 		~GLContextScope();
 
 		GLContextVersion GetVersion() const { return m_Context->GetVersion(); }
-		bool HasExtension(const std::string_view& extensionName) const;
+		const GLCapabilities& GetCapabilities() const { return m_Context->GetCapabilities(); }
+		bool HasExtension(const std::string_view& extensionName) const { return GetCapabilities().HasExtension(extensionName); }
+
+		// Only calls SDL_GL_SetSwapInterval if the interval actually changed. Returns false if
+		// the driver rejected it (for example adaptive vsync without EXT_swap_control_tear).
+		bool SetSwapInterval(int interval);
+
+		// Scopes leave their context bound to the thread when they exit, so consecutive scopes for the
+		// same window don't pay for SDL_GL_MakeCurrent. The thread keeps the context locked until it binds
+		// another one or calls this, so a scope for it on another thread waits until then. Call this when
+		// the thread is done with GL.
+		static void ReleaseCurrent();
+		// Call before destroying an SDL window, in case it's still bound on this thread
+		static void ReleaseWindow(SDL_Window* window);
+
+		// New context with the same version that shares objects (textures, buffers, programs) with this one,
+		// for use on another thread. Container objects like VAOs and FBOs are never shared. Returns nullptr on failure.
+		std::shared_ptr<GLContext> CreateSharedContext() const;
 
 		void* GetProcAddress(const char* symbolName) const;
 		template<typename T> T GetProcAddress(const char* symbolName) const { return static_cast<T>(GetProcAddress(symbolName)); }
 
 	private:
+		SDL_Window* m_Window;
 		std::shared_ptr<GLContext> m_Context;
 		std::lock_guard<std::recursive_mutex> m_ContextActiveLock;
 	};
@@ -0,0 +1,56 @@
+#include "GLProbeCache.h"
+#include "ImGuiDesktopInternal.h"
+
+#include <mh/text/format.hpp>
+
+#include <fstream>
+#include <system_error>
+
+using namespace ImGuiDesktop;
+
+// Plain text so it can be inspected (or deleted) by hand when a driver misbehaves
+static constexpr const char CACHE_HEADER[] = "imgui_desktop GL probe cache v1";
+
+std::optional<GLProbeCache> ImGuiDesktop::LoadGLProbeCache(const std::filesystem::path& path)
+{
+	std::ifstream file(path);
+	if (!file)
+		return std::nullopt;
+
+	std::string header;
+	GLProbeCache cache;
+	if (!std::getline(file, header) || header != CACHE_HEADER ||
+		!(file >> cache.m_Version.m_Major >> cache.m_Version.m_Minor) ||
+		!(file >> std::ws) ||
+		!std::getline(file, cache.m_Vendor) ||
+		!std::getline(file, cache.m_Renderer) ||
+		!std::getline(file, cache.m_VersionString))
+	{
+		PrintLogMsg(mh::format("Ignoring malformed GL probe cache {}", path.string()));
+		return std::nullopt;
+	}
+
+	return cache;
+}
+
+bool ImGuiDesktop::SaveGLProbeCache(const GLProbeCache& cache, const std::filesystem::path& path)
+{
+	std::error_code ec;
+	if (path.has_parent_path())
+		std::filesystem::create_directories(path.parent_path(), ec);
+
+	std::ofstream file(path, std::ios::trunc);
+	file << CACHE_HEADER << '\n'
+		<< cache.m_Version.m_Major << ' ' << cache.m_Version.m_Minor << '\n'
+		<< cache.m_Vendor << '\n'
+		<< cache.m_Renderer << '\n'
+		<< cache.m_VersionString << '\n';
+
+	if (!file)
+	{
+		PrintLogMsg(mh::format("Failed to write GL probe cache {}", path.string()));
+		return false;
+	}
+
+	return true;
+}
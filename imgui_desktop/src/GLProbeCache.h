@@ -0,0 +1,27 @@
+#pragma once
+
+#include "GLContextVersion.h"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace ImGuiDesktop
+{
+	// The context version that worked last time, and the driver it worked on
+	struct GLProbeCache
+	{
+		GLContextVersion m_Version;
+		std::string m_Vendor;
+		std::string m_Renderer;
+		std::string m_VersionString;
+
+		bool IsSameDriver(const GLProbeCache& other) const
+		{
+			return m_Vendor == other.m_Vendor && m_Renderer == other.m_Renderer && m_VersionString == other.m_VersionString;
+		}
+	};
+
+	std::optional<GLProbeCache> LoadGLProbeCache(const std::filesystem::path& path);
+	bool SaveGLProbeCache(const GLProbeCache& cache, const std::filesystem::path& path);
+}
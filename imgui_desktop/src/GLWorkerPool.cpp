@@ -0,0 +1,278 @@
+#include "GLWorkerPool.h"
+#include "GLContext.h"
+#include "ImGuiDesktopInternal.h"
+
+#ifdef IMGUI_USE_GLAD2
+#include <glad/gl.h>
+#else
+#error fixme
+#endif
+
+#include <mh/text/format.hpp>
+#include <SDL.h>
+
+#include <stdexcept>
+
+using namespace ImGuiDesktop;
+
+GLWorkerPool::GLWorkerPool() = default;
+
+GLWorkerPool::~GLWorkerPool()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_ShouldExit = true;
+	}
+	m_CV.notify_all();
+
+	for (auto& worker : m_Workers)
+	{
+		if (worker->m_Thread.joinable())
+			worker->m_Thread.join();
+	}
+
+	if (m_MainWindow && !m_Completions.empty())
+	{
+		GLContextScope scope(m_MainWindow.get(), m_MainContext);
+		for (const Completion& completion : m_Completions)
+		{
+			if (completion.m_Fence)
+				glDeleteSync(static_cast<GLsync>(completion.m_Fence));
+		}
+	}
+
+	// Worker contexts were released by their threads, so they can be deleted from here
+	m_Workers.clear();
+}
+
+void GLWorkerPool::Post(std::function<void()> job, std::function<void()> onComplete)
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Jobs.push_back({ std::move(job), std::move(onComplete) });
+	}
+
+	m_CV.notify_one();
+	RequestUpdate();
+}
+
+void GLWorkerPool::Start(const std::shared_ptr<GLContext>& mainContext, size_t workerCount)
+{
+	if (m_IsStarted)
+		return;
+
+	m_IsStarted = true;
+	m_MainContext = mainContext;
+
+	m_MainWindow = CreateHiddenWindow();
+	if (!m_MainWindow)
+		throw std::runtime_error(mh::format("Failed to create the hidden window for GL workers: {}", SDL_GetError()));
+
+	// Completions wait on fences from the worker contexts
+	if (!mainContext->GetCapabilities().HasSync())
+	{
+		PrintLogMsg("No sync object support, running GL jobs on the main thread");
+		return;
+	}
+
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		auto worker = std::make_unique<Worker>();
+		worker->m_Window = CreateHiddenWindow();
+		if (!worker->m_Window)
+			break;
+
+		// Created while the main context is current on our own window, the worker's window is its thread's business
+		worker->m_Context = CreateGLWorkerContext(m_MainWindow.get());
+		if (!worker->m_Context)
+			break;
+
+		worker->m_Thread = std::thread(&GLWorkerPool::ThreadFunc, this, std::ref(*worker));
+		m_Workers.push_back(std::move(worker));
+	}
+
+	if (m_Workers.empty())
+		PrintLogMsg("Failed to create a shared GL context for any GL worker, running GL jobs on the main thread");
+	else if (m_Workers.size() < workerCount)
+		PrintLogMsg(mh::format("Only created {} of {} GL workers", m_Workers.size(), workerCount));
+}
+
+bool GLWorkerPool::HasJobs() const
+{
+	std::lock_guard lock(m_Mutex);
+	return !m_Jobs.empty();
+}
+
+bool GLWorkerPool::HasPendingCompletions() const
+{
+	std::lock_guard lock(m_Mutex);
+	return !m_Completions.empty();
+}
+
+bool GLWorkerPool::ProcessCompletions()
+{
+	if (!m_IsStarted)
+		return false;
+
+	std::deque<Job> inlineJobs;
+	std::vector<Completion> completions;
+	{
+		std::lock_guard lock(m_Mutex);
+		if (m_Workers.empty())
+			inlineJobs.swap(m_Jobs);
+
+		completions.swap(m_Completions);
+	}
+
+	if (inlineJobs.empty() && completions.empty())
+		return false;
+
+	GLContextScope scope(m_MainWindow.get(), m_MainContext);
+
+	for (Job& job : inlineJobs)
+	{
+		// Same context as the windows, so no fence needed
+		Completion& completion = completions.emplace_back();
+		completion.m_OnComplete = std::move(job.m_OnComplete);
+		try
+		{
+			job.m_Func();
+		}
+		catch (...)
+		{
+			completion.m_Exception = std::current_exception();
+		}
+	}
+
+	// Put anything the GPU isn't done with back first, so a throwing completion can't lose it
+	std::vector<Completion> pending;
+	for (auto it = completions.begin(); it != completions.end(); )
+	{
+		if (it->m_Fence)
+		{
+			const auto fence = static_cast<GLsync>(it->m_Fence);
+			const GLenum result = glClientWaitSync(fence, 0, 0);
+			if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+			{
+				pending.push_back(std::move(*it));
+				it = completions.erase(it);
+				continue;
+			}
+
+			glDeleteSync(fence);
+			it->m_Fence = nullptr;
+		}
+
+		++it;
+	}
+
+	if (!pending.empty())
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Completions.insert(m_Completions.begin(),
+			std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.end()));
+	}
+
+	bool hasCompleted = false;
+	std::exception_ptr exception;
+	for (size_t i = 0; i < completions.size(); i++)
+	{
+		Completion& completion = completions[i];
+		if (completion.m_Exception)
+		{
+			if (!exception)
+				exception = completion.m_Exception;
+		}
+		else if (completion.m_OnComplete)
+		{
+			try
+			{
+				completion.m_OnComplete();
+			}
+			catch (...)
+			{
+				// Everything after it already signaled, and runs on the next call
+				std::lock_guard lock(m_Mutex);
+				m_Completions.insert(m_Completions.begin(),
+					std::make_move_iterator(completions.begin() + i + 1), std::make_move_iterator(completions.end()));
+				throw;
+			}
+
+			hasCompleted = true;
+		}
+	}
+
+	if (exception)
+		std::rethrow_exception(exception);
+
+	return hasCompleted;
+}
+
+void GLWorkerPool::WindowDeleter::operator()(SDL_Window* window) const
+{
+	GLContextScope::ReleaseWindow(window);
+	SDL_DestroyWindow(window);
+}
+
+auto GLWorkerPool::CreateHiddenWindow() -> WindowPtr
+{
+	// Never shown, only here because a context needs a drawable to be made current
+	WindowPtr window(SDL_CreateWindow("imgui_desktop GL worker", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+		1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN));
+	if (!window)
+		SDL_PRINT_AND_CLEAR_ERROR();
+
+	return window;
+}
+
+void GLWorkerPool::ThreadFunc(Worker& worker)
+{
+	{
+		GLContextScope scope(worker.m_Window.get(), worker.m_Context);
+
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock lock(m_Mutex);
+				m_CV.wait(lock, [&] { return m_ShouldExit || !m_Jobs.empty(); });
+				if (m_ShouldExit)
+					break;
+
+				job = std::move(m_Jobs.front());
+				m_Jobs.pop_front();
+			}
+
+			Completion completion;
+			completion.m_OnComplete = std::move(job.m_OnComplete);
+			try
+			{
+				job.m_Func();
+			}
+			catch (...)
+			{
+				completion.m_Exception = std::current_exception();
+			}
+
+			// Covers everything the job issued. Without the flush, neither the fence nor those commands
+			// are guaranteed to ever reach the GPU, and the main thread would poll it forever.
+			completion.m_Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+
+			{
+				std::lock_guard lock(m_Mutex);
+				m_Completions.push_back(std::move(completion));
+			}
+
+			RequestUpdate();
+		}
+	}
+
+	GLContextScope::ReleaseCurrent();
+}
+
+void GLWorkerPool::RequestUpdate()
+{
+	if (m_UpdateRequestFunc)
+		m_UpdateRequestFunc();
+}
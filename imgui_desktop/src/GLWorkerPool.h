@@ -0,0 +1,96 @@
+#pragma once
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SDL_Window;
+
+namespace ImGuiDesktop
+{
+	class GLContext;
+
+	// Worker threads, each with a hidden window and its own GL context sharing objects with the main one,
+	// so shader compiles, buffer fills and texture uploads don't block frames. After a job runs, its
+	// worker fences everything the job issued, and the completion only runs on the main thread once that
+	// fence has signaled. Post() is safe from any thread, everything else is main thread only.
+	class GLWorkerPool final : mh::disable_copy_move
+	{
+	public:
+		GLWorkerPool();
+		~GLWorkerPool();
+
+		// Jobs posted before Start() wait for it
+		void Post(std::function<void()> job, std::function<void()> onComplete);
+
+		// Creates the windows, contexts and threads. Needs SDL video and the main context, and no
+		// GLContextScope active on this thread. If the main context has no sync objects, or no worker
+		// context can be created, jobs run on the main thread from ProcessCompletions() instead.
+		void Start(const std::shared_ptr<GLContext>& mainContext, size_t workerCount);
+		bool IsStarted() const { return m_IsStarted; }
+		bool HasJobs() const;
+
+		// Runs the completions of every job whose fence has signaled, in the order the jobs finished.
+		// Same requirements as Start(). Rethrows the first exception thrown by a job. Returns whether
+		// any onComplete ran.
+		bool ProcessCompletions();
+		// Jobs that finished, but whose fences haven't signaled yet (or weren't checked yet). Nothing
+		// signals when they do, ProcessCompletions() has to keep being called until this is false.
+		bool HasPendingCompletions() const;
+
+		// Called whenever a job is posted or finishes. May be called from any thread.
+		void SetUpdateRequestFunc(std::function<void()> func) { m_UpdateRequestFunc = std::move(func); }
+
+	private:
+		struct Job
+		{
+			std::function<void()> m_Func;
+			std::function<void()> m_OnComplete;
+		};
+
+		struct Completion
+		{
+			void* m_Fence = nullptr; // GLsync
+			std::function<void()> m_OnComplete;
+			std::exception_ptr m_Exception;
+		};
+
+		struct WindowDeleter
+		{
+			void operator()(SDL_Window* window) const;
+		};
+		using WindowPtr = std::unique_ptr<SDL_Window, WindowDeleter>;
+
+		struct Worker
+		{
+			WindowPtr m_Window;
+			std::shared_ptr<GLContext> m_Context;
+			std::thread m_Thread;
+		};
+
+		static WindowPtr CreateHiddenWindow();
+		void ThreadFunc(Worker& worker);
+		void RequestUpdate();
+
+		std::shared_ptr<GLContext> m_MainContext;
+		WindowPtr m_MainWindow; // The main context is made current on this to poll fences
+		std::vector<std::unique_ptr<Worker>> m_Workers;
+		bool m_IsStarted = false;
+
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_CV;
+		std::deque<Job> m_Jobs;
+		std::vector<Completion> m_Completions;
+		bool m_ShouldExit = false;
+
+		std::function<void()> m_UpdateRequestFunc;
+	};
+}
@@ -0,0 +1,90 @@
+#include "GPUFrameTimer.h"
+#include "GLContext.h"
+
+#ifdef IMGUI_USE_GLAD2
+#include <glad/gl.h>
+#else
+#error fixme
+#endif
+
+#include <cassert>
+
+using namespace ImGuiDesktop;
+
+bool GPUFrameTimer::IsSupported(const GLContextScope& scope)
+{
+	return scope.GetCapabilities().HasTimerQuery();
+}
+
+GPUFrameTimer::GPUFrameTimer()
+{
+	for (auto& slot : m_Slots)
+		glGenQueries(GLsizei(slot.m_Queries.size()), slot.m_Queries.data());
+}
+
+GPUFrameTimer::~GPUFrameTimer()
+{
+	for (auto& slot : m_Slots)
+		glDeleteQueries(GLsizei(slot.m_Queries.size()), slot.m_Queries.data());
+}
+
+void GPUFrameTimer::BeginFrame(uint64_t frameIndex)
+{
+	assert(!m_IsInFrame);
+	if (m_PendingCount >= m_Slots.size())
+		return;
+
+	m_Slots[(m_ReadIndex + m_PendingCount) % m_Slots.size()].m_FrameIndex = frameIndex;
+	m_IsInFrame = true;
+	Mark(Point::RenderStart);
+}
+
+void GPUFrameTimer::Mark(Point point)
+{
+	if (!m_IsInFrame)
+		return;
+
+	const auto& slot = m_Slots[(m_ReadIndex + m_PendingCount) % m_Slots.size()];
+	glQueryCounter(slot.m_Queries[size_t(point)], GL_TIMESTAMP);
+}
+
+void GPUFrameTimer::EndFrame()
+{
+	if (!m_IsInFrame)
+		return;
+
+	Mark(Point::PresentEnd);
+	m_IsInFrame = false;
+	m_PendingCount++;
+}
+
+bool GPUFrameTimer::PopResult(uint64_t& frameIndex, std::array<float, size_t(GPUFramePhase::COUNT)>& phaseMS)
+{
+	if (m_PendingCount == 0)
+		return false;
+
+	const auto& slot = m_Slots[m_ReadIndex];
+
+	// Queries complete in order, so if the last one is done they all are
+	GLint available = 0;
+	glGetQueryObjectiv(slot.m_Queries[size_t(Point::PresentEnd)], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return false;
+
+	std::array<GLuint64, size_t(Point::COUNT)> timestamps;
+	for (size_t i = 0; i < timestamps.size(); i++)
+		glGetQueryObjectui64v(slot.m_Queries[i], GL_QUERY_RESULT, &timestamps[i]);
+
+	const auto ToMS = [&](Point begin, Point end)
+	{
+		return float(double(timestamps[size_t(end)] - timestamps[size_t(begin)]) / 1'000'000);
+	};
+
+	frameIndex = slot.m_FrameIndex;
+	phaseMS[size_t(GPUFramePhase::RenderDrawData)] = ToMS(Point::RenderStart, Point::RenderEnd);
+	phaseMS[size_t(GPUFramePhase::Swap)] = ToMS(Point::RenderEnd, Point::PresentEnd);
+
+	m_ReadIndex = (m_ReadIndex + 1) % m_Slots.size();
+	m_PendingCount--;
+	return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "FrameTimings.h"
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace ImGuiDesktop
+{
+	class GLContextScope;
+
+	// GL_TIMESTAMP queries around the GPU side of a frame. Results are only read once the
+	// driver says they're available, a few frames later, so this never stalls the pipeline.
+	// The owning GL context must be current whenever any member, including the destructor, is called.
+	class GPUFrameTimer final : mh::disable_copy_move
+	{
+	public:
+		enum class Point
+		{
+			RenderStart,
+			RenderEnd,
+			PresentEnd,
+
+			COUNT,
+		};
+
+		// Needs OpenGL 3.3 or ARB_timer_query
+		static bool IsSupported(const GLContextScope& scope);
+
+		GPUFrameTimer();
+		~GPUFrameTimer();
+
+		// Also marks Point::RenderStart. If every slot is still waiting on the GPU, this
+		// frame just isn't timed and the other calls until the next BeginFrame do nothing.
+		void BeginFrame(uint64_t frameIndex);
+		void Mark(Point point);
+		void EndFrame();
+
+		// Oldest first. Returns false once there are no more finished frames.
+		bool PopResult(uint64_t& frameIndex, std::array<float, size_t(GPUFramePhase::COUNT)>& phaseMS);
+
+	private:
+		static constexpr size_t FRAME_LATENCY = 4;
+
+		struct Slot
+		{
+			std::array<uint32_t, size_t(Point::COUNT)> m_Queries{};
+			uint64_t m_FrameIndex = 0;
+		};
+
+		std::array<Slot, FRAME_LATENCY> m_Slots;
+		size_t m_ReadIndex = 0;
+		size_t m_PendingCount = 0;
+		bool m_IsInFrame = false;
+	};
+}
@@ -0,0 +1,60 @@
+#include "ImGuiAllocator.h"
+
+#include <imgui.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+using namespace ImGuiDesktop;
+
+namespace
+{
+	std::atomic<uint64_t> s_TotalCount = 0;
+	std::atomic<uint64_t> s_TotalBytes = 0;
+	thread_local AllocationStats* s_CurrentStats = nullptr;
+
+	void* ImGuiAlloc(size_t size, void*)
+	{
+		s_TotalCount.fetch_add(1, std::memory_order_relaxed);
+		s_TotalBytes.fetch_add(size, std::memory_order_relaxed);
+
+		if (AllocationStats* stats = s_CurrentStats)
+		{
+			stats->m_Count++;
+			stats->m_Bytes += size;
+		}
+
+		return std::malloc(size);
+	}
+
+	void ImGuiFree(void* ptr, void*)
+	{
+		std::free(ptr);
+	}
+}
+
+AllocationStats ImGuiDesktop::GetImGuiAllocationTotals()
+{
+	AllocationStats stats;
+	stats.m_Count = s_TotalCount.load(std::memory_order_relaxed);
+	stats.m_Bytes = s_TotalBytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void ImGuiDesktop::InstallImGuiAllocator()
+{
+	static std::once_flag s_Installed;
+	std::call_once(s_Installed, [] { ImGui::SetAllocatorFunctions(&ImGuiAlloc, &ImGuiFree); });
+}
+
+ImGuiAllocationScope::ImGuiAllocationScope(AllocationStats& stats) :
+	m_PrevStats(s_CurrentStats)
+{
+	s_CurrentStats = &stats;
+}
+
+ImGuiAllocationScope::~ImGuiAllocationScope()
+{
+	s_CurrentStats = m_PrevStats;
+}
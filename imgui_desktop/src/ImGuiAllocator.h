@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Allocation.h"
+
+#include <mh/types/disable_copy_move.hpp>
+
+namespace ImGuiDesktop
+{
+	// Routes imgui's allocations through our counting allocator. Only does anything the first time.
+	void InstallImGuiAllocator();
+
+	// While alive, imgui allocations made on this thread are also counted in stats
+	class ImGuiAllocationScope final : mh::disable_copy_move
+	{
+	public:
+		explicit ImGuiAllocationScope(AllocationStats& stats);
+		~ImGuiAllocationScope();
+
+	private:
+		AllocationStats* m_PrevStats;
+	};
+}
@@ -10,6 +10,10 @@ namespace ImGuiDesktop
 {
 	void PrintLogMsg(const std::string_view& msg, MH_SOURCE_LOCATION_AUTO(location));
 	void PrintLogMsg(const char* msg, MH_SOURCE_LOCATION_AUTO(location));
+
+	// True only if built with IMGUI_DESKTOP_THREAD_LOCAL_CONTEXT *and* imgui itself was compiled with our
+	// thread local GImGui. Checked once, on the main thread, while no other thread is using imgui.
+	bool IsImGuiContextThreadLocal();
 }
 
 #define SDL_PRINT_AND_CLEAR_ERROR() \
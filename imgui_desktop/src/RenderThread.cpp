@@ -0,0 +1,146 @@
+#include "RenderThread.h"
+#include "Window.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace ImGuiDesktop;
+
+namespace
+{
+	// ImVector's operator= frees and reallocates, this keeps the old capacity around
+	template<typename T>
+	void CopyVector(ImVector<T>& dst, const ImVector<T>& src)
+	{
+		dst.resize(src.Size);
+		if (src.Size > 0)
+			std::memcpy(dst.Data, src.Data, size_t(src.size_in_bytes()));
+	}
+}
+
+RenderThread::RenderThread(std::function<void(ImDrawData&, int)> renderFunc, std::function<void()> exitFunc) :
+	m_RenderFunc(std::move(renderFunc)),
+	m_ExitFunc(std::move(exitFunc))
+{
+	m_Thread = std::thread(&RenderThread::ThreadFunc, this);
+}
+
+RenderThread::~RenderThread()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_ShouldExit = true;
+	}
+
+	m_CV.notify_all();
+	m_Thread.join();
+}
+
+void RenderThread::Submit(const ImDrawData& drawData, int swapInterval, size_t maxQueuedFrames)
+{
+	maxQueuedFrames = std::clamp<size_t>(maxQueuedFrames, 1, MAX_QUEUED_FRAMES);
+
+	size_t writeIndex;
+	{
+		std::unique_lock lock(m_Mutex);
+
+		if (m_QueuedCount >= maxQueuedFrames)
+		{
+			const auto waitStart = std::chrono::steady_clock::now();
+			m_CV.wait(lock, [&] { return m_QueuedCount < maxQueuedFrames; });
+			m_WaitTime += std::chrono::steady_clock::now() - waitStart;
+			m_WaitCount++;
+		}
+
+		writeIndex = (m_ReadIndex + m_QueuedCount + (m_IsRendering ? 1 : 0)) % m_Snapshots.size();
+	}
+
+	// Nobody else touches this slot until it's queued
+	Snapshot& snapshot = m_Snapshots[writeIndex];
+	CopyDrawData(drawData, snapshot);
+	snapshot.m_SwapInterval = swapInterval;
+
+	{
+		std::lock_guard lock(m_Mutex);
+		m_QueuedCount++;
+		m_SubmittedFrames++;
+	}
+
+	m_CV.notify_all();
+}
+
+void RenderThread::Flush()
+{
+	std::unique_lock lock(m_Mutex);
+	m_CV.wait(lock, [&] { return m_QueuedCount == 0 && !m_IsRendering; });
+}
+
+void RenderThread::GetStats(RenderThreadStats& stats) const
+{
+	std::lock_guard lock(m_Mutex);
+	stats.m_SubmittedFrames = m_SubmittedFrames;
+	stats.m_PresentedFrames = m_PresentedFrames;
+	stats.m_WaitCount = m_WaitCount;
+	stats.m_WaitTime = m_WaitTime;
+}
+
+void RenderThread::CopyDrawData(const ImDrawData& src, Snapshot& dst)
+{
+	dst.m_DrawData = src;
+
+	while (dst.m_CmdLists.size() < size_t(src.CmdListsCount))
+		dst.m_CmdLists.push_back(std::make_unique<ImDrawList>(nullptr));
+
+	dst.m_CmdListPtrs.resize(size_t(src.CmdListsCount));
+	for (int i = 0; i < src.CmdListsCount; i++)
+	{
+		const ImDrawList& srcList = *src.CmdLists[i];
+		ImDrawList& dstList = *dst.m_CmdLists[i];
+
+		CopyVector(dstList.CmdBuffer, srcList.CmdBuffer);
+		CopyVector(dstList.IdxBuffer, srcList.IdxBuffer);
+		CopyVector(dstList.VtxBuffer, srcList.VtxBuffer);
+		dstList.Flags = srcList.Flags;
+
+		dst.m_CmdListPtrs[i] = &dstList;
+	}
+
+	dst.m_DrawData.CmdLists = dst.m_CmdListPtrs.data();
+}
+
+void RenderThread::ThreadFunc()
+{
+	while (true)
+	{
+		Snapshot* snapshot;
+		{
+			std::unique_lock lock(m_Mutex);
+			m_CV.wait(lock, [&] { return m_QueuedCount > 0 || m_ShouldExit; });
+
+			// Anything still queued is finished first, so the last frame always makes it to the screen
+			if (m_QueuedCount == 0)
+				break;
+
+			snapshot = &m_Snapshots[m_ReadIndex];
+			m_QueuedCount--;
+			m_IsRendering = true;
+		}
+
+		// Frees up a queue slot for the UI thread right away
+		m_CV.notify_all();
+
+		m_RenderFunc(snapshot->m_DrawData, snapshot->m_SwapInterval);
+
+		{
+			std::lock_guard lock(m_Mutex);
+			m_IsRendering = false;
+			m_ReadIndex = (m_ReadIndex + 1) % m_Snapshots.size();
+			m_PresentedFrames++;
+		}
+
+		m_CV.notify_all();
+	}
+
+	m_ExitFunc();
+}
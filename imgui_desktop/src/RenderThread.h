@@ -0,0 +1,72 @@
+#pragma once
+
+#include <imgui.h>
+#include <mh/types/disable_copy_move.hpp>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ImGuiDesktop
+{
+	struct RenderThreadStats;
+
+	// Renders (and presents) deep copies of imgui draw data on a dedicated thread, so a
+	// swap blocked on vsync doesn't hold up the thread that built the frame.
+	class RenderThread final : mh::disable_copy_move
+	{
+	public:
+		static constexpr size_t MAX_QUEUED_FRAMES = 3;
+
+		// renderFunc is called on the render thread for every submitted frame, exitFunc
+		// once on the render thread right before it exits (to clean up GL objects etc).
+		RenderThread(std::function<void(ImDrawData& drawData, int swapInterval)> renderFunc, std::function<void()> exitFunc);
+		~RenderThread();
+
+		// Copies drawData and queues it for rendering. If maxQueuedFrames frames are already
+		// waiting for the render thread, blocks until it picks one up.
+		void Submit(const ImDrawData& drawData, int swapInterval, size_t maxQueuedFrames);
+
+		// Blocks until everything submitted so far has been presented
+		void Flush();
+
+		void GetStats(RenderThreadStats& stats) const;
+
+	private:
+		struct Snapshot
+		{
+			ImDrawData m_DrawData;
+			std::vector<std::unique_ptr<ImDrawList>> m_CmdLists;
+			std::vector<ImDrawList*> m_CmdListPtrs;
+			int m_SwapInterval = 0;
+		};
+
+		static void CopyDrawData(const ImDrawData& src, Snapshot& dst);
+		void ThreadFunc();
+
+		std::function<void(ImDrawData&, int)> m_RenderFunc;
+		std::function<void()> m_ExitFunc;
+
+		// One more than can be queued, for the one being rendered
+		std::array<Snapshot, MAX_QUEUED_FRAMES + 1> m_Snapshots;
+
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_CV;
+		size_t m_ReadIndex = 0;
+		size_t m_QueuedCount = 0;
+		bool m_IsRendering = false;
+		bool m_ShouldExit = false;
+
+		uint64_t m_SubmittedFrames = 0;
+		uint64_t m_PresentedFrames = 0;
+		uint64_t m_WaitCount = 0;
+		std::chrono::steady_clock::duration m_WaitTime{};
+
+		std::thread m_Thread;
+	};
+}
@@ -0,0 +1,551 @@
+#include "Renderer.h"
+#include "GLContext.h"
+#include "ImGuiDesktopInternal.h"
+#include "StreamBuffer.h"
+#include "TextureManager.h"
+
+#ifdef IMGUI_USE_GLAD2
+#include <glad/gl.h>
+#else
+#error fixme
+#endif
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace ImGuiDesktop;
+using namespace std::string_literals;
+
+namespace
+{
+	enum AttribLocation : GLuint
+	{
+		ATTRIB_POSITION,
+		ATTRIB_UV,
+		ATTRIB_COLOR,
+	};
+
+	static constexpr GLuint TRANSFORM_BLOCK_BINDING = 0;
+
+	struct ScissorRect
+	{
+		GLint m_X;
+		GLint m_Y;
+		GLsizei m_Width;
+		GLsizei m_Height;
+
+		bool operator==(const ScissorRect&) const = default;
+	};
+
+	// Everything SetupRenderState() and the draws touch, put back afterwards so raw GL in OnPreDraw()/
+	// OnEndFrame() and the next window see what they left behind. Same set as the stock OpenGL3 backend.
+	class GLStateBackup final
+	{
+	public:
+		GLStateBackup()
+		{
+			glGetIntegerv(GL_ACTIVE_TEXTURE, &m_ActiveTexture);
+			glActiveTexture(GL_TEXTURE0);
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &m_Texture);
+			glGetIntegerv(GL_CURRENT_PROGRAM, &m_Program);
+			glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &m_ArrayBuffer);
+			glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &m_VertexArray);
+			glGetIntegerv(GL_UNIFORM_BUFFER_BINDING, &m_UniformBuffer);
+			glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, TRANSFORM_BLOCK_BINDING, &m_TransformBlockBuffer);
+			glGetIntegerv(GL_POLYGON_MODE, m_PolygonMode);
+			glGetIntegerv(GL_VIEWPORT, m_Viewport);
+			glGetIntegerv(GL_SCISSOR_BOX, m_ScissorBox);
+			glGetIntegerv(GL_BLEND_SRC_RGB, &m_BlendSrcRGB);
+			glGetIntegerv(GL_BLEND_DST_RGB, &m_BlendDstRGB);
+			glGetIntegerv(GL_BLEND_SRC_ALPHA, &m_BlendSrcAlpha);
+			glGetIntegerv(GL_BLEND_DST_ALPHA, &m_BlendDstAlpha);
+			glGetIntegerv(GL_BLEND_EQUATION_RGB, &m_BlendEquationRGB);
+			glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &m_BlendEquationAlpha);
+			m_IsBlendEnabled = glIsEnabled(GL_BLEND);
+			m_IsCullFaceEnabled = glIsEnabled(GL_CULL_FACE);
+			m_IsDepthTestEnabled = glIsEnabled(GL_DEPTH_TEST);
+			m_IsStencilTestEnabled = glIsEnabled(GL_STENCIL_TEST);
+			m_IsScissorTestEnabled = glIsEnabled(GL_SCISSOR_TEST);
+		}
+
+		~GLStateBackup()
+		{
+			glUseProgram(GLuint(m_Program));
+			glBindTexture(GL_TEXTURE_2D, GLuint(m_Texture));
+			glActiveTexture(GLenum(m_ActiveTexture));
+			glBindVertexArray(GLuint(m_VertexArray));
+			glBindBuffer(GL_ARRAY_BUFFER, GLuint(m_ArrayBuffer));
+
+			// Binding the indexed target also changes the generic one
+			glBindBufferBase(GL_UNIFORM_BUFFER, TRANSFORM_BLOCK_BINDING, GLuint(m_TransformBlockBuffer));
+			glBindBuffer(GL_UNIFORM_BUFFER, GLuint(m_UniformBuffer));
+
+			glBlendEquationSeparate(GLenum(m_BlendEquationRGB), GLenum(m_BlendEquationAlpha));
+			glBlendFuncSeparate(GLenum(m_BlendSrcRGB), GLenum(m_BlendDstRGB), GLenum(m_BlendSrcAlpha), GLenum(m_BlendDstAlpha));
+			SetEnabled(GL_BLEND, m_IsBlendEnabled);
+			SetEnabled(GL_CULL_FACE, m_IsCullFaceEnabled);
+			SetEnabled(GL_DEPTH_TEST, m_IsDepthTestEnabled);
+			SetEnabled(GL_STENCIL_TEST, m_IsStencilTestEnabled);
+			SetEnabled(GL_SCISSOR_TEST, m_IsScissorTestEnabled);
+
+			// Core profiles only have GL_FRONT_AND_BACK
+			glPolygonMode(GL_FRONT_AND_BACK, GLenum(m_PolygonMode[0]));
+			glViewport(m_Viewport[0], m_Viewport[1], GLsizei(m_Viewport[2]), GLsizei(m_Viewport[3]));
+			glScissor(m_ScissorBox[0], m_ScissorBox[1], GLsizei(m_ScissorBox[2]), GLsizei(m_ScissorBox[3]));
+		}
+
+	private:
+		static void SetEnabled(GLenum cap, GLboolean enabled)
+		{
+			if (enabled)
+				glEnable(cap);
+			else
+				glDisable(cap);
+		}
+
+		GLint m_ActiveTexture;
+		GLint m_Texture;
+		GLint m_Program;
+		GLint m_ArrayBuffer;
+		GLint m_VertexArray;
+		GLint m_UniformBuffer;
+		GLint m_TransformBlockBuffer;
+		GLint m_PolygonMode[2];
+		GLint m_Viewport[4];
+		GLint m_ScissorBox[4];
+		GLint m_BlendSrcRGB;
+		GLint m_BlendDstRGB;
+		GLint m_BlendSrcAlpha;
+		GLint m_BlendDstAlpha;
+		GLint m_BlendEquationRGB;
+		GLint m_BlendEquationAlpha;
+		GLboolean m_IsBlendEnabled;
+		GLboolean m_IsCullFaceEnabled;
+		GLboolean m_IsDepthTestEnabled;
+		GLboolean m_IsStencilTestEnabled;
+		GLboolean m_IsScissorTestEnabled;
+	};
+
+	// The projection lives in a uniform block rather than a plain uniform. Uniform values belong to the
+	// program, which is shared across contexts, while buffer bindings belong to each context.
+	static constexpr const char VERTEX_SHADER[] = R"(
+#version 150
+layout(std140) uniform Transform
+{
+	mat4 ProjMtx;
+};
+
+in vec2 Position;
+in vec2 UV;
+in vec4 Color;
+out vec2 Frag_UV;
+out vec4 Frag_Color;
+
+void main()
+{
+	Frag_UV = UV;
+	Frag_Color = Color;
+	gl_Position = ProjMtx * vec4(Position.xy, 0, 1);
+}
+)";
+
+	static constexpr const char FRAGMENT_SHADER[] = R"(
+#version 150
+uniform sampler2D Texture;
+
+in vec2 Frag_UV;
+in vec4 Frag_Color;
+out vec4 Out_Color;
+
+void main()
+{
+	Out_Color = Frag_Color * texture(Texture, Frag_UV.st);
+}
+)";
+
+	static GLuint CompileShader(GLenum type, const char* source)
+	{
+		const GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+
+		GLint status = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			GLchar log[1024]{};
+			glGetShaderInfoLog(shader, GLsizei(std::size(log)), nullptr, log);
+			glDeleteShader(shader);
+			throw std::runtime_error("Failed to compile imgui "s << (type == GL_VERTEX_SHADER ? "vertex" : "fragment")
+				<< " shader: " << log);
+		}
+
+		return shader;
+	}
+
+	static GLuint LinkProgram()
+	{
+		const GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, VERTEX_SHADER);
+		GLuint fragmentShader;
+		try
+		{
+			fragmentShader = CompileShader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+		}
+		catch (...)
+		{
+			glDeleteShader(vertexShader);
+			throw;
+		}
+
+		const GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glBindAttribLocation(program, ATTRIB_POSITION, "Position");
+		glBindAttribLocation(program, ATTRIB_UV, "UV");
+		glBindAttribLocation(program, ATTRIB_COLOR, "Color");
+		glLinkProgram(program);
+
+		glDetachShader(program, vertexShader);
+		glDetachShader(program, fragmentShader);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			GLchar log[1024]{};
+			glGetProgramInfoLog(program, GLsizei(std::size(log)), nullptr, log);
+			glDeleteProgram(program);
+			throw std::runtime_error("Failed to link imgui program: "s << log);
+		}
+
+		return program;
+	}
+}
+
+RendererBuffers::RendererBuffers() = default;
+
+RendererBuffers::~RendererBuffers()
+{
+	if (m_VAO)
+		glDeleteVertexArrays(1, &m_VAO);
+	if (m_UBO)
+		glDeleteBuffers(1, &m_UBO);
+}
+
+bool Renderer::IsSupported(const GLContextScope& scope)
+{
+	// Base vertex draws (RendererHasVtxOffset) and uniform blocks
+	return scope.GetVersion() >= GLContextVersion(3, 2);
+}
+
+Renderer::Renderer(const GLContextScope& scope, TextureManager& textureManager) :
+	m_TextureManager(textureManager),
+	m_IsPersistentMappingSupported(StreamBuffer::IsPersistentMappingSupported(scope))
+{
+	if (!m_IsPersistentMappingSupported)
+		PrintLogMsg("No buffer storage support, streaming draw data by orphaning buffers instead");
+
+	m_Program = LinkProgram();
+
+	glUniformBlockBinding(m_Program, glGetUniformBlockIndex(m_Program, "Transform"), TRANSFORM_BLOCK_BINDING);
+
+	GLint prevProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &prevProgram);
+	glUseProgram(m_Program);
+	glUniform1i(glGetUniformLocation(m_Program, "Texture"), 0);
+	glUseProgram(GLuint(prevProgram));
+}
+
+Renderer::~Renderer()
+{
+	m_TextureManager.ReleaseGLResources();
+
+	if (m_FontTexture)
+		glDeleteTextures(1, &m_FontTexture);
+
+	glDeleteProgram(m_Program);
+}
+
+void Renderer::InitImGuiIO(ImGuiIO& io) const
+{
+	io.BackendRendererName = "imgui_desktop_opengl3";
+	io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+}
+
+void Renderer::UpdateTextures(ImFontAtlas& atlas, uint64_t atlasGeneration)
+{
+	if (m_FontTexture && atlasGeneration == m_FontGeneration)
+	{
+		// Another renderer (or the stock backend) may have been using the atlas in the meantime
+		atlas.SetTexID(ImTextureID(intptr_t(m_FontTexture)));
+		return;
+	}
+
+	unsigned char* pixels;
+	int width, height;
+	atlas.GetTexDataAsRGBA32(&pixels, &width, &height);
+
+	GLint prevTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &prevTexture);
+
+	if (!m_FontTexture)
+		glGenTextures(1, &m_FontTexture);
+
+	glBindTexture(GL_TEXTURE_2D, m_FontTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindTexture(GL_TEXTURE_2D, GLuint(prevTexture));
+
+	m_FontGeneration = atlasGeneration;
+	atlas.SetTexID(ImTextureID(intptr_t(m_FontTexture)));
+}
+
+void Renderer::SetupRenderState(const ImDrawData& drawData, RendererBuffers& buffers,
+	int32_t fbWidth, int32_t fbHeight) const
+{
+	glEnable(GL_BLEND);
+	glBlendEquation(GL_FUNC_ADD);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_STENCIL_TEST);
+	glEnable(GL_SCISSOR_TEST);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	glViewport(0, 0, fbWidth, fbHeight);
+
+	// Orthographic projection, top left of the display at DisplayPos
+	const float l = drawData.DisplayPos.x;
+	const float r = drawData.DisplayPos.x + drawData.DisplaySize.x;
+	const float t = drawData.DisplayPos.y;
+	const float b = drawData.DisplayPos.y + drawData.DisplaySize.y;
+	const float projection[4][4] =
+	{
+		{ 2.0f / (r - l),    0.0f,              0.0f, 0.0f },
+		{ 0.0f,              2.0f / (t - b),    0.0f, 0.0f },
+		{ 0.0f,              0.0f,             -1.0f, 0.0f },
+		{ (r + l) / (l - r), (t + b) / (b - t), 0.0f, 1.0f },
+	};
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffers.m_UBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(projection), projection, GL_STREAM_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, TRANSFORM_BLOCK_BINDING, buffers.m_UBO);
+
+	glUseProgram(m_Program);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(buffers.m_VAO);
+}
+
+RenderStats Renderer::RenderDrawData(const ImDrawData& drawData, RendererBuffers* buffersPtr)
+{
+	RenderStats stats;
+
+	const auto fbWidth = int32_t(drawData.DisplaySize.x * drawData.FramebufferScale.x);
+	const auto fbHeight = int32_t(drawData.DisplaySize.y * drawData.FramebufferScale.y);
+	if (fbWidth <= 0 || fbHeight <= 0 || drawData.TotalVtxCount <= 0)
+		return stats;
+
+	const GLStateBackup stateBackup;
+
+	RendererBuffers& buffers = buffersPtr ? *buffersPtr : m_SharedBuffers;
+	if (!buffers.m_VAO)
+	{
+		glGenVertexArrays(1, &buffers.m_VAO);
+		glGenBuffers(1, &buffers.m_UBO);
+		buffers.m_Stream = std::make_unique<StreamBuffer>(m_IsPersistentMappingSupported);
+	}
+
+	// Every command list goes into one range of the stream buffer, vertices first, then indices. Starting
+	// on a multiple of sizeof(ImDrawVert) means each command's base vertex can be used as is.
+	const size_t vtxSize = size_t(drawData.TotalVtxCount) * sizeof(ImDrawVert);
+	const size_t idxSize = size_t(drawData.TotalIdxCount) * sizeof(ImDrawIdx);
+	size_t streamOffset;
+	auto* dst = static_cast<std::byte*>(buffers.m_Stream->Map(vtxSize + idxSize, sizeof(ImDrawVert), streamOffset));
+	if (!dst)
+	{
+		PrintLogMsg("Failed to map the stream buffer, skipping frame");
+		return stats;
+	}
+
+	{
+		std::byte* vtxDst = dst;
+		std::byte* idxDst = dst + vtxSize;
+		for (int i = 0; i < drawData.CmdListsCount; i++)
+		{
+			const ImDrawList& cmdList = *drawData.CmdLists[i];
+			const size_t listVtxSize = size_t(cmdList.VtxBuffer.Size) * sizeof(ImDrawVert);
+			const size_t listIdxSize = size_t(cmdList.IdxBuffer.Size) * sizeof(ImDrawIdx);
+			std::memcpy(vtxDst, cmdList.VtxBuffer.Data, listVtxSize);
+			std::memcpy(idxDst, cmdList.IdxBuffer.Data, listIdxSize);
+			vtxDst += listVtxSize;
+			idxDst += listIdxSize;
+		}
+	}
+
+	buffers.m_Stream->Unmap();
+	stats.m_UploadBytes = vtxSize + idxSize;
+	stats.m_IsPersistentlyMapped = buffers.m_Stream->IsPersistent();
+
+	// The VAO remembers the attribute layout and the index buffer binding, the stream buffer is replaced when it
+	// grows. The replacement can get the same name back, so that alone doesn't tell us.
+	if (const uint64_t generation = buffers.m_Stream->GetGeneration(); buffers.m_VAOGeneration != generation)
+	{
+		const uint32_t streamBuffer = buffers.m_Stream->GetBuffer();
+		glBindVertexArray(buffers.m_VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, streamBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, streamBuffer);
+		glEnableVertexAttribArray(ATTRIB_POSITION);
+		glEnableVertexAttribArray(ATTRIB_UV);
+		glEnableVertexAttribArray(ATTRIB_COLOR);
+		glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (const void*)offsetof(ImDrawVert, pos));
+		glVertexAttribPointer(ATTRIB_UV, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (const void*)offsetof(ImDrawVert, uv));
+		glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (const void*)offsetof(ImDrawVert, col));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		buffers.m_VAOGeneration = generation;
+	}
+
+	SetupRenderState(drawData, buffers, fbWidth, fbHeight);
+
+	const ImVec2 clipOffset = drawData.DisplayPos;
+	const ImVec2 clipScale = drawData.FramebufferScale;
+	const GLenum indexType = sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+	// Consecutive commands with the same texture and scissor rect, even from different lists, are
+	// gathered into one batch. Each batch is a single multi-draw, with runs that are also contiguous
+	// in the index buffer (and use the same base vertex) fused into one sub-draw.
+	ScissorRect batchScissor{};
+	GLuint batchTexture{};
+	std::optional<ScissorRect> boundScissor;
+	std::optional<GLuint> boundTexture;
+	buffers.m_BatchCounts.clear();
+	buffers.m_BatchOffsets.clear();
+	buffers.m_BatchBaseVertices.clear();
+
+	const auto FlushBatch = [&]
+	{
+		const auto drawCount = GLsizei(buffers.m_BatchCounts.size());
+		if (drawCount == 0)
+			return;
+
+		if (boundScissor != batchScissor)
+		{
+			glScissor(batchScissor.m_X, batchScissor.m_Y, batchScissor.m_Width, batchScissor.m_Height);
+			boundScissor = batchScissor;
+		}
+
+		if (boundTexture != batchTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, batchTexture);
+			boundTexture = batchTexture;
+		}
+
+		// Both are core in 3.2, which the renderer requires
+		if (drawCount > 1)
+		{
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, buffers.m_BatchCounts.data(), indexType,
+				buffers.m_BatchOffsets.data(), drawCount, buffers.m_BatchBaseVertices.data());
+		}
+		else
+		{
+			glDrawElementsBaseVertex(GL_TRIANGLES, buffers.m_BatchCounts[0], indexType,
+				buffers.m_BatchOffsets[0], buffers.m_BatchBaseVertices[0]);
+		}
+
+		stats.m_DrawCalls++;
+
+		buffers.m_BatchCounts.clear();
+		buffers.m_BatchOffsets.clear();
+		buffers.m_BatchBaseVertices.clear();
+	};
+
+	auto listVtxStart = unsigned(streamOffset / sizeof(ImDrawVert));
+	auto listIdxStart = unsigned((streamOffset + vtxSize) / sizeof(ImDrawIdx));
+	for (int i = 0; i < drawData.CmdListsCount; i++)
+	{
+		const ImDrawList& cmdList = *drawData.CmdLists[i];
+		for (const ImDrawCmd& cmd : cmdList.CmdBuffer)
+		{
+			if (cmd.UserCallback)
+			{
+				FlushBatch();
+
+				if (cmd.UserCallback == ImDrawCallback_ResetRenderState)
+					SetupRenderState(drawData, buffers, fbWidth, fbHeight);
+				else
+					cmd.UserCallback(&cmdList, &cmd);
+
+				// Whatever the callback did to the GL state, we don't know about it
+				boundScissor.reset();
+				boundTexture.reset();
+				continue;
+			}
+
+			// Clip rect in framebuffer pixels
+			const ImVec2 clipMin((cmd.ClipRect.x - clipOffset.x) * clipScale.x, (cmd.ClipRect.y - clipOffset.y) * clipScale.y);
+			const ImVec2 clipMax((cmd.ClipRect.z - clipOffset.x) * clipScale.x, (cmd.ClipRect.w - clipOffset.y) * clipScale.y);
+			if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y || cmd.ElemCount == 0)
+				continue;
+
+			GLuint texture = GLuint(intptr_t(cmd.GetTexID()));
+			if (TextureManager::IsManagedTextureID(cmd.GetTexID()))
+			{
+				texture = m_TextureManager.ResolveForDraw(cmd.GetTexID());
+				if (!texture)
+					continue; // Still uploading (or evicted and queued again)
+			}
+
+			stats.m_DrawCommands++;
+
+			const ScissorRect scissor
+			{
+				GLint(clipMin.x), GLint(float(fbHeight) - clipMax.y),
+				GLsizei(clipMax.x - clipMin.x), GLsizei(clipMax.y - clipMin.y),
+			};
+			if (scissor != batchScissor || texture != batchTexture)
+			{
+				FlushBatch();
+				batchScissor = scissor;
+				batchTexture = texture;
+			}
+
+			const auto count = GLsizei(cmd.ElemCount);
+			const auto offset = reinterpret_cast<const void*>(uintptr_t((listIdxStart + cmd.IdxOffset) * sizeof(ImDrawIdx)));
+			const auto baseVertex = GLint(listVtxStart + cmd.VtxOffset);
+
+			auto& counts = buffers.m_BatchCounts;
+			auto& offsets = buffers.m_BatchOffsets;
+			if (!counts.empty() && buffers.m_BatchBaseVertices.back() == baseVertex &&
+				uintptr_t(offsets.back()) + size_t(counts.back()) * sizeof(ImDrawIdx) == uintptr_t(offset))
+			{
+				counts.back() += count;
+			}
+			else
+			{
+				counts.push_back(count);
+				offsets.push_back(offset);
+				buffers.m_BatchBaseVertices.push_back(baseVertex);
+			}
+		}
+
+		listVtxStart += unsigned(cmdList.VtxBuffer.Size);
+		listIdxStart += unsigned(cmdList.IdxBuffer.Size);
+	}
+
+	FlushBatch();
+
+	buffers.m_Stream->EndFrame();
+	return stats;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "FrameTimings.h"
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct ImDrawData;
+struct ImFontAtlas;
+struct ImGuiIO;
+
+namespace ImGuiDesktop
+{
+	class GLContextScope;
+	class StreamBuffer;
+	class TextureManager;
+
+	// Vertex array, streaming vertex/index buffer and projection uniform buffer. VAOs are never shared
+	// between GL contexts, so every context that renders needs its own set. Created on first use, the
+	// owning context must be current whenever any member, including the destructor, is called.
+	class RendererBuffers final : mh::disable_copy_move
+	{
+	public:
+		RendererBuffers();
+		~RendererBuffers();
+
+	private:
+		friend class Renderer;
+
+		uint32_t m_VAO = 0;
+		uint64_t m_VAOGeneration = 0; // Stream buffer generation the VAO's attributes currently point into
+		uint32_t m_UBO = 0;
+		std::unique_ptr<StreamBuffer> m_Stream; // Vertices followed by indices, one range per frame
+
+		// Sub-draws of the batch being built, kept around so they don't allocate every frame
+		std::vector<int32_t> m_BatchCounts;
+		std::vector<const void*> m_BatchOffsets;
+		std::vector<int32_t> m_BatchBaseVertices;
+	};
+
+	// OpenGL 3.2 renderer for imgui draw data, shared by every window. There is a single program and a
+	// single font texture, living on the shared context, and windows on that context also share one set
+	// of streaming buffers. Contexts sharing objects with it (render threads) only need their own
+	// RendererBuffers. Textures from the TextureManager are resolved at draw time, commands using ones
+	// that aren't resident yet are skipped. The shared context must be current for everything except
+	// RenderDrawData().
+	class Renderer final : mh::disable_copy_move
+	{
+	public:
+		static bool IsSupported(const GLContextScope& scope);
+
+		// Compiles the program, throws std::runtime_error if that fails
+		Renderer(const GLContextScope& scope, TextureManager& textureManager);
+		~Renderer();
+
+		// Fills in the backend name and capabilities of the current imgui context
+		void InitImGuiIO(ImGuiIO& io) const;
+
+		// Uploads the atlas (building it if needed) if its generation changed since the last call
+		void UpdateTextures(ImFontAtlas& atlas, uint64_t atlasGeneration);
+
+		// Draws into the currently bound framebuffer, and puts back any GL state it changed. buffers
+		// must belong to the current context, nullptr means the shared context's buffers.
+		RenderStats RenderDrawData(const ImDrawData& drawData, RendererBuffers* buffers = nullptr);
+
+	private:
+		void SetupRenderState(const ImDrawData& drawData, RendererBuffers& buffers,
+			int32_t fbWidth, int32_t fbHeight) const;
+
+		TextureManager& m_TextureManager;
+		uint32_t m_Program = 0;
+		bool m_IsPersistentMappingSupported = false; // Same driver for the shared contexts, so the same answer
+		RendererBuffers m_SharedBuffers;
+
+		uint32_t m_FontTexture = 0;
+		uint64_t m_FontGeneration = 0;
+	};
+}
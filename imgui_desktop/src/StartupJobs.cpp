@@ -0,0 +1,74 @@
+#include "StartupJobs.h"
+#include "ImGuiDesktopInternal.h"
+
+#include <cassert>
+#include <utility>
+
+using namespace ImGuiDesktop;
+using namespace std::string_literals;
+
+StartupJobs::~StartupJobs()
+{
+	Wait();
+}
+
+void StartupJobs::Add(std::string name, std::function<void()> job)
+{
+	assert(!m_IsStarted);
+	m_Jobs.push_back({ std::move(name), std::move(job) });
+}
+
+void StartupJobs::Start()
+{
+	if (m_IsStarted)
+		return;
+
+	m_IsStarted = true;
+
+	if (!m_Jobs.empty())
+		m_Worker = std::thread(&StartupJobs::RunJobs, this);
+}
+
+void StartupJobs::Join(std::vector<StartupTimelineEntry>& timeline)
+{
+	if (m_IsJoined)
+		return;
+
+	Start();
+	Wait();
+
+	m_IsJoined = true;
+	m_Jobs.clear();
+	timeline.insert(timeline.end(), m_Timeline.begin(), m_Timeline.end());
+	m_Timeline.clear();
+
+	if (m_Exception)
+		std::rethrow_exception(std::exchange(m_Exception, nullptr));
+}
+
+void StartupJobs::Wait()
+{
+	if (m_Worker.joinable())
+		m_Worker.join();
+}
+
+void StartupJobs::RunJobs()
+{
+	for (Job& job : m_Jobs)
+	{
+		const auto start = clock::now();
+
+		try
+		{
+			job.m_Func();
+		}
+		catch (...)
+		{
+			PrintLogMsg("Startup job \""s << job.m_Name << "\" threw an exception");
+			if (!m_Exception)
+				m_Exception = std::current_exception();
+		}
+
+		m_Timeline.push_back({ job.m_Name, start - m_Epoch, clock::now() - start, true });
+	}
+}
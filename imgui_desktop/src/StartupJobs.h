@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Application.h"
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ImGuiDesktop
+{
+	// Jobs that run on a single worker thread while the first window brings up SDL and OpenGL.
+	// Add() and Start() are main thread only, Start() only does anything the first time.
+	class StartupJobs final : mh::disable_copy_move
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+		explicit StartupJobs(clock::time_point epoch) : m_Epoch(epoch) {}
+		~StartupJobs();
+
+		// Only before Start()
+		void Add(std::string name, std::function<void()> job);
+
+		void Start();
+		bool IsStarted() const { return m_IsStarted; }
+
+		// Blocks until every job has finished, if they were started
+		void Wait();
+
+		// Wait()s, then hands over their timeline entries. Rethrows
+		// the first exception thrown by a job. Does nothing if the jobs were already joined.
+		void Join(std::vector<StartupTimelineEntry>& timeline);
+		bool IsJoined() const { return m_IsJoined; }
+
+	private:
+		struct Job
+		{
+			std::string m_Name;
+			std::function<void()> m_Func;
+		};
+
+		void RunJobs();
+
+		clock::time_point m_Epoch;
+		std::vector<Job> m_Jobs;
+		bool m_IsStarted = false;
+		bool m_IsJoined = false;
+		std::thread m_Worker;
+
+		// Only touched by the worker until it is joined
+		std::vector<StartupTimelineEntry> m_Timeline;
+		std::exception_ptr m_Exception;
+	};
+}
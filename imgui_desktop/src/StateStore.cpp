@@ -0,0 +1,164 @@
+#include "StateStore.h"
+
+#include <imgui_internal.h>
+
+#include <algorithm>
+
+using namespace ImGuiDesktop;
+
+static const ImGuiID HOOK_OWNER = ImHashStr("ImGuiDesktop::StateStore");
+
+StateStore::StateStore() = default;
+StateStore::~StateStore() = default;
+
+StateStore& StateStore::GetCurrent()
+{
+	ImGuiContext* context = ImGui::GetCurrentContext();
+	assert(context);
+
+	// The context doesn't have anywhere else to hang our data off of, and hooks are a handful of entries at most
+	for (const ImGuiContextHook& hook : context->Hooks)
+	{
+		if (hook.Owner == HOOK_OWNER && hook.Type == ImGuiContextHookType_Shutdown)
+			return *static_cast<StateStore*>(hook.UserData);
+	}
+
+	ImGuiContextHook hook;
+	hook.Type = ImGuiContextHookType_Shutdown;
+	hook.Owner = HOOK_OWNER;
+	hook.UserData = new StateStore();
+	hook.Callback = [](ImGuiContext*, ImGuiContextHook* shutdownHook)
+	{
+		delete static_cast<StateStore*>(shutdownHook->UserData);
+		shutdownHook->UserData = nullptr;
+	};
+
+	ImGui::AddContextHook(context, &hook);
+	return *static_cast<StateStore*>(hook.UserData);
+}
+
+size_t StateStore::GetSlotIndex(ImGuiID id) const
+{
+	// IDs are already hashes, but not necessarily good ones in the low bits. Fibonacci hashing spreads them out.
+	return size_t((uint32_t(id) * 0x9E3779B1u) >> (32 - m_SlotBits));
+}
+
+size_t StateStore::FindSlot(ImGuiID id) const
+{
+	if (m_Slots.empty())
+		return 0;
+
+	const size_t mask = m_Slots.size() - 1;
+	for (size_t i = GetSlotIndex(id); ; i = (i + 1) & mask)
+	{
+		const Slot& slot = m_Slots[i];
+		if (!slot.m_Value)
+			return m_Slots.size();
+
+		if (slot.m_ID == id)
+			return i;
+	}
+}
+
+void* StateStore::FindRaw(ImGuiID id, size_t size) const
+{
+	const size_t i = FindSlot(id);
+	if (i == m_Slots.size())
+		return nullptr;
+
+	assert(m_Slots[i].m_Size == size);
+	return m_Slots[i].m_Value;
+}
+
+bool StateStore::Erase(ImGuiID id)
+{
+	size_t hole = FindSlot(id);
+	if (hole == m_Slots.size())
+		return false;
+
+	// No tombstones: anything later in the same probe run that could have gone in the hole is shifted
+	// back into it, which leaves a new hole further along, until the run ends.
+	const size_t mask = m_Slots.size() - 1;
+	for (size_t i = (hole + 1) & mask; m_Slots[i].m_Value; i = (i + 1) & mask)
+	{
+		// Stays put if its home slot is in (hole, i], cyclically
+		const size_t home = GetSlotIndex(m_Slots[i].m_ID);
+		const bool isReachable = hole <= i ? (home > hole && home <= i) : (home > hole || home <= i);
+		if (isReachable)
+			continue;
+
+		m_Slots[hole] = m_Slots[i];
+		hole = i;
+	}
+
+	m_Slots[hole] = {};
+	m_Count--;
+	return true;
+}
+
+void* StateStore::InsertRaw(ImGuiID id, size_t size, size_t alignment)
+{
+	assert(!FindRaw(id, size));
+
+	// Never more than half full, so probe sequences stay short
+	if ((m_Count + 1) * 2 > m_Slots.size())
+		Grow();
+
+	const size_t mask = m_Slots.size() - 1;
+	size_t i = GetSlotIndex(id);
+	while (m_Slots[i].m_Value)
+		i = (i + 1) & mask;
+
+	Slot& slot = m_Slots[i];
+	slot.m_ID = id;
+	slot.m_Size = uint32_t(size);
+	slot.m_Value = Allocate(size, alignment);
+	m_Count++;
+	return slot.m_Value;
+}
+
+void* StateStore::Allocate(size_t size, size_t alignment)
+{
+	const auto Align = [&](std::byte* ptr)
+	{
+		return reinterpret_cast<std::byte*>((reinterpret_cast<uintptr_t>(ptr) + alignment - 1) & ~uintptr_t(alignment - 1));
+	};
+
+	std::byte* pos = m_ChunkPos ? Align(m_ChunkPos) : nullptr;
+	if (!pos || pos + size > m_ChunkEnd)
+	{
+		// Anything too big for a chunk gets one to itself, and the current chunk keeps going
+		const size_t chunkSize = std::max(size, CHUNK_SIZE);
+		auto& chunk = m_Chunks.emplace_back(std::make_unique<std::byte[]>(chunkSize));
+		if (chunkSize > CHUNK_SIZE)
+			return chunk.get();
+
+		m_ChunkPos = pos = chunk.get();
+		m_ChunkEnd = pos + chunkSize;
+	}
+
+	m_ChunkPos = pos + size;
+	return pos;
+}
+
+void StateStore::Grow()
+{
+	std::vector<Slot> oldSlots = std::move(m_Slots);
+
+	m_SlotBits = std::max<uint32_t>(m_SlotBits + 1, 6);
+	m_Slots.clear();
+	m_Slots.resize(size_t(1) << m_SlotBits);
+
+	const size_t mask = m_Slots.size() - 1;
+	for (const Slot& slot : oldSlots)
+	{
+		if (!slot.m_Value)
+			continue;
+
+		size_t i = GetSlotIndex(slot.m_ID);
+		while (m_Slots[i].m_Value)
+			i = (i + 1) & mask;
+
+		m_Slots[i] = slot;
+	}
+}
@@ -0,0 +1,199 @@
+#include "StreamBuffer.h"
+#include "GLContext.h"
+#include "ImGuiDesktopInternal.h"
+
+#ifdef IMGUI_USE_GLAD2
+#include <glad/gl.h>
+#else
+#error fixme
+#endif
+
+#include <algorithm>
+#include <cassert>
+
+using namespace ImGuiDesktop;
+
+// Doesn't disturb the VAO's element array binding, or anyone's array buffer binding
+static constexpr GLenum MAP_TARGET = GL_COPY_WRITE_BUFFER;
+
+static constexpr GLbitfield PERSISTENT_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+static constexpr size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool StreamBuffer::IsPersistentMappingSupported(const GLContextScope& scope)
+{
+	const GLCapabilities& caps = scope.GetCapabilities();
+	return caps.HasBufferStorage() && caps.HasSync();
+}
+
+StreamBuffer::StreamBuffer(bool persistent, size_t initialCapacity) :
+	m_IsPersistent(persistent)
+{
+	Create(initialCapacity);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	Destroy();
+}
+
+void StreamBuffer::Create(size_t capacity)
+{
+	m_Capacity = capacity;
+	m_Head = 0;
+	m_Generation++;
+
+	glGenBuffers(1, &m_Buffer);
+	glBindBuffer(MAP_TARGET, m_Buffer);
+
+	if (m_IsPersistent)
+	{
+		glBufferStorage(MAP_TARGET, GLsizeiptr(capacity), nullptr, PERSISTENT_FLAGS);
+		m_PersistentPtr = static_cast<std::byte*>(glMapBufferRange(MAP_TARGET, 0, GLsizeiptr(capacity), PERSISTENT_FLAGS));
+		if (!m_PersistentPtr)
+		{
+			PrintLogMsg("Failed to persistently map the stream buffer, falling back to orphaning");
+			glDeleteBuffers(1, &m_Buffer);
+			m_IsPersistent = false;
+			Create(capacity);
+			return;
+		}
+	}
+	else
+	{
+		glBufferData(MAP_TARGET, GLsizeiptr(capacity), nullptr, GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(MAP_TARGET, 0);
+}
+
+void StreamBuffer::Destroy()
+{
+	assert(!m_IsMapped);
+
+	// Deleting a buffer the GPU is still reading from is fine, GL keeps the storage alive until it's done
+	for (const PendingRange& range : m_PendingRanges)
+		glDeleteSync(static_cast<GLsync>(range.m_Sync));
+
+	m_PendingRanges.clear();
+
+	if (m_PersistentPtr)
+	{
+		glBindBuffer(MAP_TARGET, m_Buffer);
+		glUnmapBuffer(MAP_TARGET);
+		glBindBuffer(MAP_TARGET, 0);
+		m_PersistentPtr = nullptr;
+	}
+
+	glDeleteBuffers(1, &m_Buffer);
+	m_Buffer = 0;
+}
+
+void StreamBuffer::WaitForRange(size_t begin, size_t end)
+{
+	// Ranges were handed out in ring order, so the oldest one is the first one we could run into
+	while (!m_PendingRanges.empty())
+	{
+		const PendingRange& range = m_PendingRanges.front();
+		const auto sync = static_cast<GLsync>(range.m_Sync);
+		if (range.m_Begin >= end || range.m_End <= begin)
+		{
+			// Clean up anything that's already done while we're here, without waiting
+			if (glClientWaitSync(sync, 0, 0) == GL_TIMEOUT_EXPIRED)
+				break;
+		}
+		else
+		{
+			while (true)
+			{
+				const GLenum result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+				if (result != GL_TIMEOUT_EXPIRED)
+					break;
+			}
+		}
+
+		glDeleteSync(sync);
+		m_PendingRanges.pop_front();
+	}
+}
+
+void* StreamBuffer::Map(size_t size, size_t alignment, size_t& offset)
+{
+	assert(!m_IsMapped);
+
+	if (size > m_Capacity)
+	{
+		Destroy();
+		Create(std::max(m_Capacity * 2, AlignUp(size, 64 * 1024)));
+	}
+
+	offset = AlignUp(m_Head, alignment);
+	const bool wrap = offset + size > m_Capacity;
+	if (wrap)
+		offset = 0;
+
+	m_FrameBegin = offset;
+	m_FrameEnd = offset + size;
+	m_IsMapped = true;
+
+	if (m_IsPersistent)
+	{
+		if (wrap)
+			WaitForRange(m_Head, m_Capacity);
+
+		WaitForRange(m_FrameBegin, m_FrameEnd);
+		m_Head = m_FrameEnd;
+		return m_PersistentPtr + offset;
+	}
+
+	glBindBuffer(MAP_TARGET, m_Buffer);
+
+	// Fresh storage, the driver keeps the old one around for as long as the GPU needs it
+	if (wrap)
+		glBufferData(MAP_TARGET, GLsizeiptr(m_Capacity), nullptr, GL_STREAM_DRAW);
+
+	// Never overlaps anything written since the last orphan, so there is nothing to synchronize with
+	void* ptr = glMapBufferRange(MAP_TARGET, GLintptr(offset), GLsizeiptr(size),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	glBindBuffer(MAP_TARGET, 0);
+
+	// Nothing to unmap, and nothing was written
+	if (!ptr)
+	{
+		m_IsMapped = false;
+		m_FrameBegin = m_FrameEnd = 0;
+		return nullptr;
+	}
+
+	m_Head = m_FrameEnd;
+	return ptr;
+}
+
+void StreamBuffer::Unmap()
+{
+	assert(m_IsMapped);
+	m_IsMapped = false;
+
+	// Coherent mapping, nothing to flush
+	if (m_IsPersistent)
+		return;
+
+	glBindBuffer(MAP_TARGET, m_Buffer);
+	if (!glUnmapBuffer(MAP_TARGET))
+		PrintLogMsg("Stream buffer contents were lost while mapped");
+
+	glBindBuffer(MAP_TARGET, 0);
+}
+
+void StreamBuffer::EndFrame()
+{
+	if (!m_IsPersistent || m_FrameEnd <= m_FrameBegin)
+		return;
+
+	m_PendingRanges.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_FrameBegin, m_FrameEnd });
+	m_FrameBegin = m_FrameEnd = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace ImGuiDesktop
+{
+	class GLContextScope;
+
+	// Ring buffer for data the GPU reads once (vertices, indices). With buffer storage the whole ring
+	// stays persistently mapped and fences keep us from overwriting anything the GPU hasn't read yet.
+	// Otherwise each write maps the range unsynchronized, and the storage is orphaned with glBufferData
+	// whenever the ring wraps around. The owning GL context must be current whenever any member,
+	// including the destructor, is called.
+	class StreamBuffer final : mh::disable_copy_move
+	{
+	public:
+		// Needs GL 4.4 or ARB_buffer_storage, plus sync objects
+		static bool IsPersistentMappingSupported(const GLContextScope& scope);
+
+		StreamBuffer(bool persistent, size_t initialCapacity = 4 * 1024 * 1024);
+		~StreamBuffer();
+
+		// Room for size bytes at an offset that is a multiple of alignment (which doesn't have to be a
+		// power of two). At most one Map() per frame, and it must be unmapped before drawing. May replace
+		// the buffer object when growing, check GetGeneration() afterwards. Returns nullptr if mapping
+		// failed, in which case there is nothing to unmap.
+		void* Map(size_t size, size_t alignment, size_t& offset);
+		void Unmap();
+
+		// Call after the draws that read the mapped range
+		void EndFrame();
+
+		uint32_t GetBuffer() const { return m_Buffer; }
+		// Changes whenever the buffer object is replaced. The new one can reuse the old one's name.
+		uint64_t GetGeneration() const { return m_Generation; }
+		size_t GetCapacity() const { return m_Capacity; }
+		bool IsPersistent() const { return m_IsPersistent; }
+
+	private:
+		struct PendingRange
+		{
+			void* m_Sync; // GLsync
+			size_t m_Begin;
+			size_t m_End;
+		};
+
+		void Create(size_t capacity);
+		void Destroy();
+		void WaitForRange(size_t begin, size_t end);
+
+		bool m_IsPersistent;
+		uint32_t m_Buffer = 0;
+		uint64_t m_Generation = 0;
+		size_t m_Capacity = 0;
+		std::byte* m_PersistentPtr = nullptr;
+
+		size_t m_Head = 0;
+		size_t m_FrameBegin = 0;
+		size_t m_FrameEnd = 0;
+		bool m_IsMapped = false;
+
+		std::deque<PendingRange> m_PendingRanges; // Oldest first
+	};
+}
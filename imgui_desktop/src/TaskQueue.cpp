@@ -0,0 +1,92 @@
+#include "TaskQueue.h"
+
+#include <cassert>
+#include <memory>
+
+using namespace ImGuiDesktop;
+
+TaskQueue::TaskQueue() :
+	m_Head(&m_Stub),
+	m_Tail(&m_Stub)
+{
+}
+
+TaskQueue::~TaskQueue()
+{
+	while (Node* node = PopNode())
+		delete node;
+}
+
+void TaskQueue::Push(Task task)
+{
+	auto node = new Node();
+	node->m_Task = std::move(task);
+	PushNode(node);
+}
+
+size_t TaskQueue::Drain()
+{
+	// If the stub is currently the newest node we can't tell where "now" ends, so just
+	// drain until empty. That only happens when a push raced with the previous pop.
+	Node* last = m_Head.load(std::memory_order_acquire);
+
+	size_t count = 0;
+	while (Node* node = PopNode())
+	{
+		const bool isLast = (node == last);
+
+		// Still freed if the task throws
+		std::unique_ptr<Node> owned(node);
+		owned->m_Task();
+		count++;
+
+		if (isLast)
+			break;
+	}
+
+	return count;
+}
+
+void TaskQueue::PushNode(Node* node)
+{
+	node->m_Next.store(nullptr, std::memory_order_relaxed);
+	Node* prev = m_Head.exchange(node, std::memory_order_acq_rel);
+	prev->m_Next.store(node, std::memory_order_release);
+}
+
+auto TaskQueue::PopNode() -> Node*
+{
+	Node* tail = m_Tail;
+	Node* next = tail->m_Next.load(std::memory_order_acquire);
+
+	if (tail == &m_Stub)
+	{
+		if (!next)
+			return nullptr;
+
+		m_Tail = next;
+		tail = next;
+		next = next->m_Next.load(std::memory_order_acquire);
+	}
+
+	if (next)
+	{
+		m_Tail = next;
+		return tail;
+	}
+
+	// A producer is halfway through linking in a new node, pick it up next time
+	if (tail != m_Head.load(std::memory_order_acquire))
+		return nullptr;
+
+	PushNode(&m_Stub);
+
+	next = tail->m_Next.load(std::memory_order_acquire);
+	if (next)
+	{
+		m_Tail = next;
+		return tail;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+namespace ImGuiDesktop
+{
+	// Lock-free multi-producer, single-consumer queue of tasks (intrusive Vyukov MPSC).
+	// Push() may be called from any thread, Drain() only from the thread that owns the queue.
+	class TaskQueue final : mh::disable_copy_move
+	{
+	public:
+		using Task = std::function<void()>;
+
+		TaskQueue();
+		~TaskQueue();
+
+		void Push(Task task);
+
+		// Runs everything that was queued when the call started, in order. Tasks queued
+		// by the tasks themselves are normally left for the next call. Returns the number of tasks run.
+		size_t Drain();
+
+	private:
+		struct Node
+		{
+			std::atomic<Node*> m_Next{};
+			Task m_Task;
+		};
+
+		void PushNode(Node* node);
+		Node* PopNode();
+
+		std::atomic<Node*> m_Head; // Producers append here
+		Node* m_Tail;              // Consumer removes from here
+		Node m_Stub;
+	};
+}
@@ -0,0 +1,506 @@
+#include "TextureManager.h"
+#include "ImGuiDesktopInternal.h"
+
+#ifdef IMGUI_USE_GLAD2
+#include <glad/gl.h>
+#else
+#error fixme
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace ImGuiDesktop;
+using namespace std::string_literals;
+
+static constexpr uint32_t BYTES_PER_PIXEL = 4;
+
+TextureManager::TextureManager() = default;
+
+// ReleaseGLResources() is called by the renderer while it still has a context, there's no GL cleanup left
+TextureManager::~TextureManager() = default;
+
+TextureHandle TextureManager::CreateTexture(uint32_t width, uint32_t height, std::vector<uint8_t> pixels)
+{
+	if (width == 0 || height == 0)
+		throw std::invalid_argument("Textures must be at least 1x1, got "s << width << 'x' << height);
+	if (pixels.size() != size_t(width) * height * BYTES_PER_PIXEL)
+	{
+		throw std::invalid_argument("Expected "s << (size_t(width) * height * BYTES_PER_PIXEL)
+			<< " bytes of pixel data for a " << width << 'x' << height << " texture, got " << pixels.size());
+	}
+
+	std::lock_guard lock(m_Mutex);
+
+	uint32_t index;
+	if (!m_FreeIndices.empty())
+	{
+		index = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+	}
+	else
+	{
+		if (m_Textures.size() >= (uint64_t(1) << INDEX_BITS))
+			throw std::runtime_error("Too many textures");
+
+		index = uint32_t(m_Textures.size());
+		m_Textures.emplace_back();
+	}
+
+	Texture& texture = m_Textures[index];
+	texture.m_Width = width;
+	texture.m_Height = height;
+	texture.m_LastUsedFrame = m_FrameIndex;
+	texture.m_Pixels = std::move(pixels);
+
+	const auto handle = TextureHandle(HANDLE_TAG | (uintptr_t(texture.m_Generation) << INDEX_BITS) | index);
+	Enqueue(handle, texture);
+	return handle;
+}
+
+void TextureManager::DestroyTexture(TextureHandle handle)
+{
+	std::lock_guard lock(m_Mutex);
+
+	if (Texture* texture = Find(handle))
+	{
+		ReleaseTexture(*texture);
+		m_FreeIndices.push_back(uint32_t(uintptr_t(handle) & ((uintptr_t(1) << INDEX_BITS) - 1)));
+		RequestUpdate();
+	}
+}
+
+void TextureManager::SetMemoryBudget(size_t bytes)
+{
+	std::lock_guard lock(m_Mutex);
+	m_MemoryBudget = bytes;
+	RequestUpdate();
+}
+
+size_t TextureManager::GetMemoryBudget() const
+{
+	std::lock_guard lock(m_Mutex);
+	return m_MemoryBudget;
+}
+
+void TextureManager::SetUploadBytesPerFrame(size_t bytes)
+{
+	std::lock_guard lock(m_Mutex);
+	m_UploadBytesPerFrame = bytes;
+}
+
+size_t TextureManager::GetUploadBytesPerFrame() const
+{
+	std::lock_guard lock(m_Mutex);
+	return m_UploadBytesPerFrame;
+}
+
+TextureManagerStats TextureManager::GetStats() const
+{
+	std::lock_guard lock(m_Mutex);
+
+	TextureManagerStats stats;
+	for (const Texture& texture : m_Textures)
+	{
+		if (texture.m_State == State::Free)
+			continue;
+
+		stats.m_TextureCount++;
+		stats.m_CPUBytes += texture.m_Pixels.size();
+		if (texture.m_State == State::Resident)
+			stats.m_ResidentCount++;
+		else if (texture.m_State == State::Queued || texture.m_State == State::Uploading)
+			stats.m_QueuedCount++;
+	}
+
+	stats.m_ResidentBytes = m_ResidentBytes;
+	stats.m_UploadedBytes = m_UploadedBytes;
+	stats.m_EvictionCount = m_EvictionCount;
+	return stats;
+}
+
+void TextureManager::SetUpdateRequestFunc(std::function<void()> func)
+{
+	std::lock_guard lock(m_Mutex);
+	m_UpdateRequestFunc = std::move(func);
+}
+
+void TextureManager::BeginFrame()
+{
+	std::lock_guard lock(m_Mutex);
+	m_FrameIndex++;
+}
+
+void TextureManager::ProcessUploads(bool isIdle)
+{
+	std::lock_guard lock(m_Mutex);
+
+	RetireUploads(false);
+
+	// Uploads are paced per frame, however often the loop wakes up in between
+	if (m_LastProcessedFrame == m_FrameIndex)
+	{
+		if (isIdle)
+			SubmitUploads();
+
+		return;
+	}
+
+	m_LastProcessedFrame = m_FrameIndex;
+
+	std::erase_if(m_DeadTextures, [&](const DeadTexture& dead)
+		{
+			if (dead.m_Frame + MIN_UNUSED_FRAMES > m_FrameIndex)
+				return false;
+
+			glDeleteTextures(1, &dead.m_GLTexture);
+			return true;
+		});
+
+	SubmitUploads();
+	Evict();
+}
+
+bool TextureManager::HasPendingWork() const
+{
+	std::lock_guard lock(m_Mutex);
+
+	const bool isUploading = std::any_of(std::begin(m_PixelBuffers), std::end(m_PixelBuffers),
+		[](const PixelBuffer& pbo) { return pbo.m_Fence != nullptr; });
+	const bool isFrameUnprocessed = m_LastProcessedFrame != m_FrameIndex;
+	return isUploading || (isFrameUnprocessed && (!m_UploadQueue.empty() || !m_DeadTextures.empty()));
+}
+
+void TextureManager::ReleaseGLResources()
+{
+	std::lock_guard lock(m_Mutex);
+
+	RetireUploads(true);
+	for (PixelBuffer& pbo : m_PixelBuffers)
+	{
+		if (pbo.m_Buffer)
+			glDeleteBuffers(1, &pbo.m_Buffer);
+
+		pbo = {};
+	}
+
+	for (const DeadTexture& dead : m_DeadTextures)
+		glDeleteTextures(1, &dead.m_GLTexture);
+
+	m_DeadTextures.clear();
+
+	// Everything goes back to being CPU only, and is uploaded again if a new renderer draws it
+	for (Texture& texture : m_Textures)
+	{
+		if (texture.m_GLTexture)
+		{
+			glDeleteTextures(1, &texture.m_GLTexture);
+			texture.m_GLTexture = 0;
+		}
+
+		if (texture.m_State != State::Free)
+		{
+			texture.m_State = State::Evicted;
+			texture.m_UploadedRows = 0;
+		}
+	}
+
+	m_UploadQueue.clear();
+	m_ResidentBytes = 0;
+	m_ResidencyGeneration++;
+}
+
+uint32_t TextureManager::ResolveForDraw(const void* textureID)
+{
+	std::lock_guard lock(m_Mutex);
+
+	Texture* texture = Find(TextureHandle(uintptr_t(textureID)));
+	if (!texture)
+		return 0;
+
+	texture->m_LastUsedFrame = m_FrameIndex;
+
+	switch (texture->m_State)
+	{
+	case State::Resident:
+		return texture->m_GLTexture;
+
+	case State::Evicted:
+		Enqueue(TextureHandle(uintptr_t(textureID)), *texture);
+		return 0;
+
+	default:
+		return 0;
+	}
+}
+
+uint64_t TextureManager::GetResidencyGeneration() const
+{
+	std::lock_guard lock(m_Mutex);
+	return m_ResidencyGeneration;
+}
+
+uint64_t TextureManager::GetResidencyGeneration(const std::vector<TextureHandle>& handles) const
+{
+	std::lock_guard lock(m_Mutex);
+
+	uint64_t generation = 0;
+	for (TextureHandle handle : handles)
+	{
+		if (const Texture* texture = Find(handle); texture && texture->m_State == State::Resident)
+			generation = std::max(generation, texture->m_ResidentGeneration);
+	}
+
+	return generation;
+}
+
+auto TextureManager::Find(TextureHandle handle) -> Texture*
+{
+	const auto value = uintptr_t(handle);
+	if (!(value & HANDLE_TAG))
+		return nullptr;
+
+	const auto index = size_t(value & ((uintptr_t(1) << INDEX_BITS) - 1));
+	const auto generation = uint32_t((value & ~HANDLE_TAG) >> INDEX_BITS);
+	if (index >= m_Textures.size())
+		return nullptr;
+
+	Texture& texture = m_Textures[index];
+	if (texture.m_State == State::Free || texture.m_Generation != generation)
+		return nullptr;
+
+	return &texture;
+}
+
+void TextureManager::Enqueue(TextureHandle handle, Texture& texture)
+{
+	texture.m_State = State::Queued;
+	texture.m_UploadedRows = 0;
+	m_UploadQueue.push_back(handle);
+	RequestUpdate();
+}
+
+void TextureManager::ReleaseTexture(Texture& texture)
+{
+	if (texture.m_GLTexture)
+	{
+		// The render thread may still be drawing with it for a few frames
+		m_DeadTextures.push_back({ texture.m_GLTexture, m_FrameIndex });
+		m_ResidentBytes -= GetSize(texture);
+	}
+
+	if (texture.m_State == State::Resident)
+		m_ResidencyGeneration++;
+
+	// Stale handles (and queue/PBO entries) no longer match. Generations have to fit above the index
+	// bits without touching the tag, and skip 0 so a handle is never the bare tag.
+	constexpr uint32_t GENERATION_MASK = uint32_t((HANDLE_TAG - 1) >> INDEX_BITS);
+	texture.m_Generation = (texture.m_Generation + 1) & GENERATION_MASK;
+	if (texture.m_Generation == 0)
+		texture.m_Generation = 1;
+
+	texture.m_State = State::Free;
+	texture.m_Width = texture.m_Height = 0;
+	texture.m_UploadedRows = 0;
+	texture.m_GLTexture = 0;
+	texture.m_Pixels = {};
+}
+
+void TextureManager::RetireUploads(bool wait)
+{
+	for (PixelBuffer& pbo : m_PixelBuffers)
+	{
+		if (!pbo.m_Fence)
+			continue;
+
+		const auto fence = static_cast<GLsync>(pbo.m_Fence);
+		const GLenum result = wait ?
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED) :
+			glClientWaitSync(fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+			continue;
+
+		glDeleteSync(fence);
+		pbo.m_Fence = nullptr;
+
+		for (TextureHandle handle : pbo.m_Completing)
+		{
+			Texture* texture = Find(handle);
+			if (texture && texture->m_State == State::Uploading)
+			{
+				texture->m_State = State::Resident;
+				texture->m_ResidentGeneration = ++m_ResidencyGeneration;
+			}
+		}
+
+		pbo.m_Completing.clear();
+	}
+}
+
+void TextureManager::SubmitUploads()
+{
+	PixelBuffer& pbo = m_PixelBuffers[m_NextPixelBuffer];
+	if (pbo.m_Fence || m_UploadQueue.empty())
+		return; // The GPU hasn't caught up with this buffer yet, try again next frame
+
+	struct Band
+	{
+		Texture* m_Texture;
+		uint32_t m_Y;
+		uint32_t m_Rows;
+		size_t m_Offset;
+	};
+
+	// Whole rows only, but always at least one so huge textures still make progress
+	std::vector<Band> bands;
+	size_t totalBytes = 0;
+	while (!m_UploadQueue.empty())
+	{
+		const TextureHandle handle = m_UploadQueue.front();
+		Texture* texture = Find(handle);
+		if (!texture || texture->m_State != State::Queued)
+		{
+			m_UploadQueue.pop_front();
+			continue;
+		}
+
+		const size_t rowBytes = size_t(texture->m_Width) * BYTES_PER_PIXEL;
+		const uint32_t remainingRows = texture->m_Height - texture->m_UploadedRows;
+		const size_t availableBytes = m_UploadBytesPerFrame > totalBytes ? m_UploadBytesPerFrame - totalBytes : 0;
+		uint32_t rows = uint32_t(std::min<size_t>(remainingRows, availableBytes / rowBytes));
+		if (rows == 0)
+		{
+			if (!bands.empty())
+				break;
+
+			rows = 1;
+		}
+
+		bands.push_back({ texture, texture->m_UploadedRows, rows, totalBytes });
+		totalBytes += rows * rowBytes;
+		texture->m_UploadedRows += rows;
+
+		if (texture->m_UploadedRows < texture->m_Height)
+			break; // Out of budget for this frame
+
+		texture->m_State = State::Uploading;
+		pbo.m_Completing.push_back(handle);
+		m_UploadQueue.pop_front();
+	}
+
+	if (bands.empty())
+		return;
+
+	GLint prevTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &prevTexture);
+
+	if (!pbo.m_Buffer)
+		glGenBuffers(1, &pbo.m_Buffer);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.m_Buffer);
+	if (pbo.m_Capacity < totalBytes)
+	{
+		pbo.m_Capacity = std::max(totalBytes, m_UploadBytesPerFrame);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(pbo.m_Capacity), nullptr, GL_STREAM_DRAW);
+	}
+
+	// The previous contents were fenced and are done with, so there's no need to wait on anything
+	auto* dst = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(totalBytes),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	if (!dst)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		PrintLogMsg("Failed to map a texture upload buffer, retrying next frame");
+
+		for (const Band& band : bands)
+		{
+			band.m_Texture->m_UploadedRows = band.m_Y;
+			band.m_Texture->m_State = State::Queued;
+		}
+
+		for (TextureHandle handle : pbo.m_Completing)
+			m_UploadQueue.push_front(handle);
+
+		pbo.m_Completing.clear();
+		return;
+	}
+
+	for (const Band& band : bands)
+	{
+		const size_t rowBytes = size_t(band.m_Texture->m_Width) * BYTES_PER_PIXEL;
+		std::memcpy(dst + band.m_Offset, band.m_Texture->m_Pixels.data() + band.m_Y * rowBytes, band.m_Rows * rowBytes);
+	}
+
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (const Band& band : bands)
+	{
+		Texture& texture = *band.m_Texture;
+		if (!texture.m_GLTexture)
+		{
+			// Storage only, the rows arrive through the PBO
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glGenTextures(1, &texture.m_GLTexture);
+			glBindTexture(GL_TEXTURE_2D, texture.m_GLTexture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GLsizei(texture.m_Width), GLsizei(texture.m_Height), 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.m_Buffer);
+			m_ResidentBytes += GetSize(texture);
+		}
+		else
+		{
+			glBindTexture(GL_TEXTURE_2D, texture.m_GLTexture);
+		}
+
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, GLint(band.m_Y), GLsizei(texture.m_Width), GLsizei(band.m_Rows),
+			GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(band.m_Offset));
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, GLuint(prevTexture));
+
+	// Partially uploaded textures are fenced too, the buffer can't be reused before the copy is done
+	pbo.m_Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_NextPixelBuffer = (m_NextPixelBuffer + 1) % PBO_COUNT;
+	m_UploadedBytes += totalBytes;
+}
+
+void TextureManager::Evict()
+{
+	while (m_ResidentBytes > m_MemoryBudget)
+	{
+		Texture* oldest = nullptr;
+		for (Texture& texture : m_Textures)
+		{
+			if (texture.m_State != State::Resident || texture.m_LastUsedFrame + MIN_UNUSED_FRAMES > m_FrameIndex)
+				continue;
+
+			if (!oldest || texture.m_LastUsedFrame < oldest->m_LastUsedFrame)
+				oldest = &texture;
+		}
+
+		if (!oldest)
+			break; // Everything over budget is still on screen
+
+		m_DeadTextures.push_back({ oldest->m_GLTexture, m_FrameIndex });
+		m_ResidentBytes -= GetSize(*oldest);
+		oldest->m_GLTexture = 0;
+		oldest->m_State = State::Evicted;
+		m_EvictionCount++;
+		m_ResidencyGeneration++;
+	}
+}
+
+void TextureManager::RequestUpdate()
+{
+	if (m_UpdateRequestFunc)
+		m_UpdateRequestFunc();
+}
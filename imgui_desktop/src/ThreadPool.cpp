@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+using namespace ImGuiDesktop;
+
+ThreadPool::ThreadPool(size_t workerCount)
+{
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	m_Workers.reserve(workerCount);
+	for (size_t i = 0; i < workerCount; i++)
+		m_Workers.emplace_back(&ThreadPool::WorkerFunc, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_ShouldExit = true;
+	}
+
+	m_WorkCV.notify_all();
+	for (auto& worker : m_Workers)
+		worker.join();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+	if (count == 0)
+		return;
+
+	{
+		std::lock_guard lock(m_Mutex);
+		assert(!m_Func);
+		m_Func = &func;
+		m_Count = count;
+		m_NextIndex = 0;
+		m_ActiveWorkers = m_Workers.size();
+		m_Generation++;
+	}
+
+	m_WorkCV.notify_all();
+
+	RunJobs();
+
+	std::unique_lock lock(m_Mutex);
+	m_DoneCV.wait(lock, [&] { return m_ActiveWorkers == 0; });
+	m_Func = nullptr;
+
+	if (m_Exception)
+		std::rethrow_exception(std::exchange(m_Exception, nullptr));
+}
+
+void ThreadPool::WorkerFunc()
+{
+	uint64_t lastGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock lock(m_Mutex);
+			m_WorkCV.wait(lock, [&] { return m_ShouldExit || m_Generation != lastGeneration; });
+			if (m_ShouldExit)
+				return;
+
+			lastGeneration = m_Generation;
+		}
+
+		RunJobs();
+
+		bool isLast;
+		{
+			std::lock_guard lock(m_Mutex);
+			isLast = --m_ActiveWorkers == 0;
+		}
+
+		if (isLast)
+			m_DoneCV.notify_one();
+	}
+}
+
+void ThreadPool::RunJobs()
+{
+	for (size_t i = m_NextIndex++; i < m_Count; i = m_NextIndex++)
+	{
+		try
+		{
+			(*m_Func)(i);
+		}
+		catch (...)
+		{
+			// Nobody picks up anything new, and ParallelFor() rethrows once everyone is done
+			m_NextIndex = m_Count;
+
+			std::lock_guard lock(m_Mutex);
+			if (!m_Exception)
+				m_Exception = std::current_exception();
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mh/types/disable_copy_move.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ImGuiDesktop
+{
+	// Fixed set of worker threads for fork/join style parallel loops
+	class ThreadPool final : mh::disable_copy_move
+	{
+	public:
+		// 0 picks one less than the number of hardware threads, since the calling thread helps out
+		explicit ThreadPool(size_t workerCount = 0);
+		~ThreadPool();
+
+		size_t GetWorkerCount() const { return m_Workers.size(); }
+
+		// Calls func(i) for every i in [0, count), spread across the workers and the calling
+		// thread. Returns once all of them are done. If any of them throw, the remaining indices
+		// are skipped, and the first exception is rethrown once the workers are done. Not reentrant.
+		void ParallelFor(size_t count, const std::function<void(size_t index)>& func);
+
+	private:
+		void WorkerFunc();
+		void RunJobs();
+
+		std::vector<std::thread> m_Workers;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_WorkCV;
+		std::condition_variable m_DoneCV;
+		bool m_ShouldExit = false;
+		uint64_t m_Generation = 0;
+		size_t m_ActiveWorkers = 0;
+
+		const std::function<void(size_t)>* m_Func = nullptr;
+		size_t m_Count = 0;
+		std::atomic<size_t> m_NextIndex = 0;
+		std::exception_ptr m_Exception; // Guarded by m_Mutex
+	};
+}
@@ -1,8 +1,17 @@
 #include "Window.h"
+#include "DamageTracker.h"
+#include "DrawDataFingerprint.h"
+#include "Framebuffer.h"
 #include "GLContext.h"
+#include "GPUFrameTimer.h"
+#include "ImGuiAllocator.h"
+#include "Renderer.h"
+#include "RenderThread.h"
 #include "ImGuiDesktopInternal.h"
 #include "Application.h"
 #include "ScopeGuards.h"
+#include "TaskQueue.h"
+#include "TextureManager.h"
 
 #ifdef IMGUI_USE_GLBINDING
 #include <glbinding/glbinding.h>
@@ -45,6 +54,36 @@ using namespace gl33core;
 using namespace ImGuiDesktop;
 using namespace std::string_literals;
 
+#ifdef IMGUI_DESKTOP_THREAD_LOCAL_CONTEXT
+thread_local ImGuiContext* g_ImGuiDesktopCurrentContext = nullptr;
+#endif
+
+bool ImGuiDesktop::IsImGuiContextThreadLocal()
+{
+#ifdef IMGUI_DESKTOP_THREAD_LOCAL_CONTEXT
+	// A prebuilt imgui without ImGuiHelpers.h as its IMGUI_USER_CONFIG still has its own global GImGui.
+	// ImGui::SetCurrentContext() then writes that one, and our thread local never changes.
+	static const bool s_IsThreadLocal = []
+	{
+		ImGuiContext* const previous = ImGui::GetCurrentContext();
+		ImGuiContext* const ours = g_ImGuiDesktopCurrentContext;
+
+		int probe;
+		const auto probeContext = reinterpret_cast<ImGuiContext*>(&probe);
+		ImGui::SetCurrentContext(probeContext); // Only stores the pointer
+		const bool isThreadLocal = g_ImGuiDesktopCurrentContext == probeContext;
+
+		ImGui::SetCurrentContext(previous);
+		g_ImGuiDesktopCurrentContext = ours;
+		return isThreadLocal;
+	}();
+
+	return s_IsThreadLocal;
+#else
+	return false;
+#endif
+}
+
 static std::function<void(const std::string_view&, const mh::source_location&)> s_LogFunc;
 void ImGuiDesktop::SetLogFunction(std::function<void(const std::string_view&, const mh::source_location&)> func)
 {
@@ -98,38 +137,98 @@ static void ValidateDriver()
 	}
 }
 
+static void ClearDefaultFramebuffer()
+{
+	glClearStencil(0);
+	glClearDepth(1.0f);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+static void CollectManagedTextures(const ImDrawData& drawData, std::vector<TextureHandle>& textures)
+{
+	textures.clear();
+	for (int i = 0; i < drawData.CmdListsCount; i++)
+	{
+		for (const ImDrawCmd& cmd : drawData.CmdLists[i]->CmdBuffer)
+		{
+			// Runs of the same texture are common, and the odd duplicate doesn't hurt
+			const auto handle = TextureHandle(uintptr_t(cmd.GetTexID()));
+			if (TextureManager::IsManagedTextureID(cmd.GetTexID()) && (textures.empty() || textures.back() != handle))
+				textures.push_back(handle);
+		}
+	}
+}
+
 auto Window::EnterGLScope() const
 {
 	return GLContextScope(m_WindowImpl.get(), m_GLContext);
 }
 
 Window::Window(Application& app, uint32_t width, uint32_t height, const char* title) :
-	m_Application(&app)
+	m_HeadlessWidth(width),
+	m_HeadlessHeight(height),
+	m_Application(&app),
+	m_PostedTasks(std::make_unique<TaskQueue>())
 {
+	auto& appInterface = static_cast<IApplicationWindowInterface&>(app);
+
+	// Font atlas and any user jobs run in the background while we bring up SDL and OpenGL
+	appInterface.StartStartupJobs();
+
+	auto phaseStart = std::chrono::steady_clock::now();
+	const auto EndStartupPhase = [&](const char* name)
+	{
+		appInterface.AddStartupPhase(name, phaseStart);
+		phaseStart = std::chrono::steady_clock::now();
+	};
+
+	// Doesn't do anything if SDL video is already up, or if the user picked a driver themselves
+	if (app.IsHeadless())
+		SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+
 	SDL_Init(SDL_INIT_VIDEO);
+	EndStartupPhase("SDL_Init");
+
+	const char* videoDriver = SDL_GetCurrentVideoDriver();
+	m_IsHeadless = app.IsHeadless() ||
+		(videoDriver && (!_stricmp(videoDriver, "offscreen") || !_stricmp(videoDriver, "dummy")));
 
 	SetupBasicWindowAttributes();
 
-	m_WindowImpl.reset(SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height,
-		SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIDDEN | SDL_WINDOW_ALLOW_HIGHDPI));
+	uint32_t windowFlags = SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN;
+	if (!m_IsHeadless)
+		windowFlags |= SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI;
+
+	m_WindowImpl.reset(SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, windowFlags));
 	if (!m_WindowImpl)
-		throw std::runtime_error("Failed to create SDL window");
+	{
+		// The "dummy" driver has no OpenGL at all, "offscreen" is the one to use for headless
+		throw std::runtime_error(mh::format("Failed to create SDL window (video driver {}): {}",
+			videoDriver ? videoDriver : "<none>", SDL_GetError()));
+	}
 
-	m_GLContext = static_cast<IApplicationWindowInterface&>(app).GetOrCreateGLContext(m_WindowImpl.get());
+	EndStartupPhase("Create window");
+
+	m_GLContext = appInterface.GetOrCreateGLContext(m_WindowImpl.get());
+	EndStartupPhase("Create OpenGL context");
 
 	auto glScope = EnterGLScope();
 
-	if (SDL_GL_SetSwapInterval(1))
-		SDL_PRINT_AND_CLEAR_ERROR();
+	if (m_IsHeadless && GetGLContextVersion().m_Major < 3)
+		PrintLogMsg("Headless rendering needs OpenGL 3, nothing will be rendered");
 
 #ifdef IMGUI_USE_GLBINDING
 	glbinding::initialize([](const char* fn) { return reinterpret_cast<glbinding::ProcAddress>(SDL_GL_GetProcAddress(fn)); });
 #endif
 
 	ValidateDriver();
+	EndStartupPhase("Validate driver");
+
+	InstallImGuiAllocator();
 
 	const bool isFirstContext = !ImGui::GetCurrentContext();
-	m_ImGuiContext.reset(ImGui::CreateContext(&app.GetFontAtlas()));
+	m_ImGuiContext.reset(ImGui::CreateContext(&appInterface.GetSharedFontAtlas()));
 
 	if (isFirstContext)
 	{
@@ -142,14 +241,20 @@ Window::Window(Application& app, uint32_t width, uint32_t height, const char* ti
 	ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 	ImGui::GetIO().IniFilename = nullptr; // Don't save stuff... for now
 
+	if (Renderer::IsSupported(glScope))
+	{
+		// Program, font texture and streaming buffers are shared with every other window
+		m_Renderer = appInterface.GetOrCreateRenderer(glScope);
+		m_Renderer->InitImGuiIO(ImGui::GetIO());
+	}
 #ifdef IMGUI_USE_OPENGL3
-	if (GetGLContextVersion().m_Major >= 3)
+	else if (GetGLContextVersion().m_Major >= 3)
 	{
 		if (!ImGui_ImplOpenGL3_Init())
 			throw std::runtime_error("Failed to initialize ImGui OpenGL3 impl");
 	}
-	else
 #endif
+	else
 	{
 		if (!ImGui_ImplOpenGL2_Init())
 			throw std::runtime_error("Failed to initialize ImGui OpenGL2 impl");
@@ -158,16 +263,36 @@ Window::Window(Application& app, uint32_t width, uint32_t height, const char* ti
 	if (!ImGui_ImplSDL2_InitForOpenGL(m_WindowImpl.get(), m_GLContext.get()))
 		throw std::runtime_error("Failed to initialize ImGui GLFW impl");
 
-	static_cast<IApplicationWindowInterface&>(GetApplication()).AddWindow(this);
+	EndStartupPhase("Initialize imgui");
+
+	appInterface.AddWindow(this);
 }
 
 Window::~Window()
 {
+	// Finishes whatever is still queued, and cleans up its GL objects on its own context
+	m_RenderThread.reset();
+
 	static_cast<IApplicationWindowInterface&>(GetApplication()).RemoveWindow(this);
+
+	if (m_Framebuffer || m_GPUTimer || m_Renderer)
+	{
+		auto scope = EnterGLScope();
+		m_Framebuffer.reset();
+		m_GPUTimer.reset();
+		m_Renderer.reset();
+	}
 }
 
 void Window::GetWindowSize(uint32_t& w, uint32_t& h) const
 {
+	if (m_IsHeadless)
+	{
+		w = m_HeadlessWidth;
+		h = m_HeadlessHeight;
+		return;
+	}
+
 	int wi, hi;
 	SDL_GetWindowSize(m_WindowImpl.get(), &wi, &hi);
 
@@ -178,18 +303,161 @@ void Window::GetWindowSize(uint32_t& w, uint32_t& h) const
 	h = static_cast<uint32_t>(hi);
 }
 
+void Window::SetHeadlessSize(uint32_t width, uint32_t height)
+{
+	m_HeadlessWidth = width;
+	m_HeadlessHeight = height;
+	MarkDirty();
+}
+
+bool Window::ReadPixels(std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height) const
+{
+	// The framebuffer belongs to the render thread's context
+	if (!m_Framebuffer || m_RenderThread)
+		return false;
+
+	auto scope = EnterGLScope();
+
+	width = m_Framebuffer->GetWidth();
+	height = m_Framebuffer->GetHeight();
+	pixels.resize(size_t(width) * height * 4);
+	m_Framebuffer->ReadPixels(pixels.data());
+	return true;
+}
+
 void Window::Update()
 {
+	// Outside of parallel frame building, the context stays current for the whole frame, so OnDraw() can use GL
+	auto scope = EnterGLScope();
+
+	UpdatePrepare();
+	UpdateBuildFrame();
+	UpdateFinish();
+}
+
+void Window::UpdatePrepare()
+{
+	m_FrameStartTime = std::chrono::steady_clock::now();
+
+	if (m_PendingFrameCount > 0)
+		m_PendingFrameCount--;
+
+	// Requests for later frames survive an early frame, only the one we're servicing is cleared
+	if (m_NextFrameTime <= m_FrameStartTime)
+		m_NextFrameTime = std::chrono::steady_clock::time_point::max();
+
+	m_FrameAllocations = {};
+	ImGuiAllocationScope allocationScope(m_FrameAllocations);
+
+	m_CurrentFrameTiming = {};
+	m_CurrentFrameTiming.m_FrameIndex = m_FrameIndex++;
+	m_CurrentFrameTiming.m_StartTime = m_FrameStartTime;
+	m_CurrentFrameTiming.m_PhaseMS[size_t(FramePhase::EventPump)] =
+		std::chrono::duration<float, std::milli>(m_EventPumpDuration).count();
+
 	OnUpdateInternal();
+	OnPreDrawInternal();
+}
+
+void Window::UpdateBuildFrame()
+{
+	ImGuiAllocationScope allocationScope(m_FrameAllocations);
 	OnDrawInternal();
 }
 
+void Window::UpdateFinish()
+{
+	{
+		ImGuiAllocationScope allocationScope(m_FrameAllocations);
+		OnEndFrameInternal();
+	}
+
+	m_CurrentFrameTiming.m_TotalMS = std::chrono::duration<float, std::milli>(
+		std::chrono::steady_clock::now() - m_FrameStartTime).count() + m_CurrentFrameTiming.GetPhaseMS(FramePhase::EventPump);
+	m_CurrentFrameTiming.m_ImGuiAllocations = m_FrameAllocations;
+	m_FrameTimings.Push(m_CurrentFrameTiming);
+
+	if (m_TargetFrameInterval > m_TargetFrameInterval.zero())
+		RequestFrameAt(m_FrameStartTime + m_TargetFrameInterval);
+}
+
+void Window::EndFramePhase(FramePhase phase)
+{
+	const auto now = std::chrono::steady_clock::now();
+	m_CurrentFrameTiming.m_PhaseMS[size_t(phase)] += std::chrono::duration<float, std::milli>(now - m_PhaseStart).count();
+	m_PhaseStart = now;
+}
+
+bool Window::IsFrameDue(std::chrono::steady_clock::time_point now) const
+{
+	return IsDirty() || m_NextFrameTime <= now || !IsSleepingEnabled();
+}
+
+void Window::RequestFrameAt(std::chrono::steady_clock::time_point time)
+{
+	m_NextFrameTime = std::min(m_NextFrameTime, time);
+}
+
+void Window::RequestFrameIn(std::chrono::steady_clock::duration delay)
+{
+	RequestFrameAt(std::chrono::steady_clock::now() + delay);
+}
+
+void Window::SetTargetFrameRate(float fps)
+{
+	if (fps > 0)
+	{
+		m_TargetFrameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<float>(1 / fps));
+	}
+	else
+	{
+		m_TargetFrameInterval = {};
+	}
+}
+
+float Window::GetTargetFrameRate() const
+{
+	if (m_TargetFrameInterval <= m_TargetFrameInterval.zero())
+		return 0;
+
+	return 1 / std::chrono::duration_cast<std::chrono::duration<float>>(m_TargetFrameInterval).count();
+}
+
+bool Window::ProcessEvent(const SDL_Event& event)
+{
+	MarkDirty();
+
+	// Exposed, resized, restored etc. might have thrown away what's on screen
+	if (event.type == SDL_WINDOWEVENT)
+		m_LastDrawDataFingerprint.reset();
+
+	ScopeGuards::Context imGuiContextScope(m_ImGuiContext.get());
+	return ImGui_ImplSDL2_ProcessEvent(&event);
+}
+
 void Window::QueueUpdate()
 {
-	m_IsUpdateQueued = true;
 	GetApplication().QueueUpdate(this);
 }
 
+void Window::Post(std::function<void()> task)
+{
+	m_PostedTasks->Push(std::move(task));
+	QueueUpdate();
+}
+
+void Window::RunPostedTasks()
+{
+	m_PostedTasks->Drain();
+}
+
+void Window::OnTextureResidencyChanged()
+{
+	if (GetApplication().GetTextureManager().GetResidencyGeneration(m_DrawnTextures) > m_TextureResidencyGeneration)
+		MarkDirty();
+}
+
 void Window::ShowWindow()
 {
 	SDL_ShowWindow(m_WindowImpl.get());
@@ -217,12 +485,16 @@ bool Window::HasFocus() const
 
 void Window::OnUpdateInternal()
 {
+	m_PhaseStart = std::chrono::steady_clock::now();
 	auto scope = EnterGLScope();
 	OnUpdate();
+	EndFramePhase(FramePhase::Update);
 }
 
-void Window::OnDrawInternal()
+void Window::OnPreDrawInternal()
 {
+	m_PhaseStart = std::chrono::steady_clock::now();
+
 	// Update FPS
 	{
 		using hrc = std::chrono::high_resolution_clock;
@@ -247,16 +519,20 @@ void Window::OnDrawInternal()
 	glbinding::useCurrentContext();
 #endif
 
-	glClearStencil(0);
-	glClearDepth(1.0f);
-	glClearColor(0, 0, 0, 0);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	UpdateGPUTimer(scope);
+	UpdateRenderThread(scope);
+
+	if (!m_RenderThread)
+		ClearDefaultFramebuffer();
 
 	assert(!ImGui::GetCurrentContext());
 	ScopeGuards::Context imGuiContextScope(m_ImGuiContext.get());
 
 	if (!m_IsInit)
 	{
+		// Fonts and user state are off limits until the startup jobs are done with them
+		static_cast<IApplicationWindowInterface&>(GetApplication()).JoinStartupJobs();
+
 		OnOpenGLInit();
 		OnImGuiInit();
 		m_IsInit = true;
@@ -264,21 +540,46 @@ void Window::OnDrawInternal()
 
 	OnPreDraw();
 
+	// Fonts may have been added in OnImGuiInit()/OnPreDraw(), the backends build the atlas right below
+	const uint64_t fontAtlasGeneration = static_cast<IApplicationWindowInterface&>(GetApplication()).EnsureFontAtlasBuilt();
+
+	if (m_Renderer)
+		m_Renderer->UpdateTextures(*ImGui::GetIO().Fonts, fontAtlasGeneration);
 #ifdef IMGUI_USE_OPENGL3
-	if (GetGLContextVersion().m_Major >= 3)
+	else if (GetGLContextVersion().m_Major >= 3)
 		ImGui_ImplOpenGL3_NewFrame();
-	else
 #endif
+	else
 		ImGui_ImplOpenGL2_NewFrame();
 
 	ImGui_ImplSDL2_NewFrame(m_WindowImpl.get());
-	ImGui::NewFrame();
+
+	if (m_IsHeadless)
 	{
-		ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiCond_Always);
+		auto& io = ImGui::GetIO();
+		io.DisplaySize = ImVec2(float(m_HeadlessWidth), float(m_HeadlessHeight));
+		io.DisplayFramebufferScale = ImVec2(1, 1);
+	}
+
+	EndFramePhase(FramePhase::PreDraw);
+}
 
-		uint32_t windowW, windowH;
-		GetWindowSize(windowW, windowH);
-		ImGui::SetNextWindowSize(ImVec2(float(windowW), float(windowH)), ImGuiCond_Always);
+void Window::OnDrawInternal()
+{
+	// Might be running on a worker thread, see Application::SetParallelFrameBuildingEnabled().
+	// Nothing in here may touch GL or SDL.
+	m_PhaseStart = std::chrono::steady_clock::now();
+
+	assert(!ImGui::GetCurrentContext());
+	ScopeGuards::Context imGuiContextScope(m_ImGuiContext.get());
+
+	auto& appInterface = static_cast<IApplicationWindowInterface&>(GetApplication());
+	appInterface.NewImGuiFrame();
+	EndFramePhase(FramePhase::PreDraw);
+	try
+	{
+		ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiCond_Always);
+		ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize, ImGuiCond_Always);
 
 		ImGuiWindowFlags windowFlags = ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoDecoration;
 		const bool hasMenuBar = HasMenuBar();
@@ -319,22 +620,329 @@ void Window::OnDrawInternal()
 		ImGui::PopStyleColor(1);
 		ImGui::PopStyleVar(2);
 	}
+	catch (...)
+	{
+		appInterface.AbandonImGuiFrame();
+		throw;
+	}
+
+	appInterface.EndImGuiFrame();
+	EndFramePhase(FramePhase::Draw);
 
 	ImGui::Render();
 
+	// Nothing else would wake us up to blink the text cursor
+	if (const auto& io = ImGui::GetIO(); io.WantTextInput && io.ConfigInputTextCursorBlink)
+		RequestFrameIn(std::chrono::milliseconds(100));
+
+	m_FrameFingerprint = CanSkipIdenticalFrames() ? GetDrawDataFingerprint(*ImGui::GetDrawData()) : std::nullopt;
+	EndFramePhase(FramePhase::ImGuiRender);
+}
+
+void Window::OnEndFrameInternal()
+{
+	m_PhaseStart = std::chrono::steady_clock::now();
+
+	auto scope = EnterGLScope();
+
+	assert(!ImGui::GetCurrentContext());
+	ScopeGuards::Context imGuiContextScope(m_ImGuiContext.get());
+
+	ImDrawData* drawData = ImGui::GetDrawData();
+
+	// Managed textures that just finished uploading change the output without changing the draw data.
+	// Every frame that might already be queued on the render thread, plus this one, is redrawn in full,
+	// because the damage tracker can't see the difference either.
+	const TextureManager& textureManager = GetApplication().GetTextureManager();
+	const uint64_t residencyGeneration = textureManager.GetResidencyGeneration();
+	CollectManagedTextures(*drawData, m_DrawnTextures);
+	if (textureManager.GetResidencyGeneration(m_DrawnTextures) > m_TextureResidencyGeneration)
+	{
+		m_LastDrawDataFingerprint.reset();
+		QueueFullRedraw();
+	}
+
+	m_TextureResidencyGeneration = residencyGeneration;
+
+	const auto& fingerprint = m_FrameFingerprint;
+	if (fingerprint && fingerprint == m_LastDrawDataFingerprint)
+	{
+		// Exactly what's already on screen, don't bother
+		m_SkippedFrameCount++;
+	}
+	else if (m_RenderThread)
+	{
+		// Anything created on this context (font atlas etc) has to be flushed before the render context can use it
+		glFlush();
+		m_RenderThread->Submit(*drawData, m_SwapInterval, m_RenderQueueDepth);
+		m_LastDrawDataFingerprint = fingerprint;
+		m_HasRenderedFrame = true;
+		EndFramePhase(FramePhase::RenderDrawData);
+	}
+	else
+	{
+		if (m_GPUTimer)
+			m_GPUTimer->BeginFrame(m_CurrentFrameTiming.m_FrameIndex);
+
+		m_CurrentFrameTiming.m_RenderStats = RenderFrame(drawData);
+		EndFramePhase(FramePhase::RenderDrawData);
+
+		if (m_GPUTimer)
+			m_GPUTimer->Mark(GPUFrameTimer::Point::RenderEnd);
+
+		Present(scope, m_SwapInterval);
+		m_LastDrawDataFingerprint = fingerprint;
+		m_HasRenderedFrame = true;
+		EndFramePhase(FramePhase::Swap);
+
+		if (m_GPUTimer)
+			m_GPUTimer->EndFrame();
+	}
+
+	OnEndFrame();
+	m_FrameArena.Reset();
+	EndFramePhase(FramePhase::EndFrame);
+}
+
+void Window::UpdateRenderThread(GLContextScope& scope)
+{
+	const bool wantRenderThread = m_IsThreadedRenderingEnabled && !m_IsHeadless;
+	if (!wantRenderThread)
+	{
+		if (m_RenderThread)
+		{
+			m_RenderThread.reset();
+			m_RenderGLContext.reset();
+			m_LastDrawDataFingerprint.reset();
+		}
+
+		return;
+	}
+
+	if (m_RenderThread)
+		return;
+
+	// The stock backends keep their state in the imgui context, which the render thread must never touch
+	if (!m_Renderer)
+	{
+		PrintLogMsg("Threaded rendering requires OpenGL 3.2, disabling it");
+		m_IsThreadedRenderingEnabled = false;
+		return;
+	}
+
+	if (!m_RenderGLContext)
+		m_RenderGLContext = scope.CreateSharedContext();
+
+	if (!m_RenderGLContext)
+	{
+		PrintLogMsg("Failed to create a shared GL context for the render thread, disabling threaded rendering");
+		m_IsThreadedRenderingEnabled = false;
+		return;
+	}
+
+	// FBOs aren't shared between contexts, the render thread makes its own
+	m_Framebuffer.reset();
+	m_LastDrawDataFingerprint.reset();
+
+	m_RenderThread = std::make_unique<RenderThread>(
+		[this](ImDrawData& drawData, int swapInterval) { RenderOnRenderThread(drawData, swapInterval); },
+		[this]
+		{
+			{
+				GLContextScope renderScope(m_WindowImpl.get(), m_RenderGLContext);
+				m_Framebuffer.reset();
+				m_RenderThreadBuffers.reset();
+			}
+
+			GLContextScope::ReleaseCurrent();
+		});
+}
+
+void Window::RenderOnRenderThread(ImDrawData& drawData, int swapInterval)
+{
+	// Only the copied draw data is used here. The imgui context belongs to the main thread, which is
+	// already building the next frame in it.
+	GLContextScope scope(m_WindowImpl.get(), m_RenderGLContext);
+
+	if (!m_RenderThreadBuffers)
+		m_RenderThreadBuffers = std::make_unique<RendererBuffers>();
+
+	ClearDefaultFramebuffer();
+	RenderFrame(&drawData);
+	Present(scope, swapInterval);
+}
+
+RenderThreadStats Window::GetRenderThreadStats() const
+{
+	RenderThreadStats stats;
+	if (m_RenderThread)
+		m_RenderThread->GetStats(stats);
+
+	return stats;
+}
+
+void Window::UpdateGPUTimer(const GLContextScope& scope)
+{
+	if (!m_IsGPUTimingEnabled)
+	{
+		m_GPUTimer.reset();
+		return;
+	}
+
+	if (!m_GPUTimer)
+	{
+		if (!GPUFrameTimer::IsSupported(scope))
+		{
+			PrintLogMsg(mh::format("GPU timing needs OpenGL 3.3 or ARB_timer_query (context version {}), disabling it",
+				scope.GetVersion()));
+			m_IsGPUTimingEnabled = false;
+			return;
+		}
+
+		m_GPUTimer = std::make_unique<GPUFrameTimer>();
+	}
+
+	// Results for earlier frames trickle in a few frames late
+	uint64_t frameIndex;
+	std::array<float, size_t(GPUFramePhase::COUNT)> phaseMS;
+	while (m_GPUTimer->PopResult(frameIndex, phaseMS))
+	{
+		if (FrameTimingSample* sample = m_FrameTimings.FindSample(frameIndex))
+		{
+			sample->m_HasGPUTimings = true;
+			sample->m_GPUPhaseMS = phaseMS;
+		}
+	}
+}
+
+void Window::SetDamageRenderingEnabled(bool enabled)
+{
+	m_IsDamageRenderingEnabled = enabled;
+
+	// The damage tracker may be in use on the render thread, so it's only ever touched from RenderFrame()
+	QueueFullRedraw();
+}
+
+void Window::QueueFullRedraw()
+{
+	// Covers every frame that might already be queued on the render thread, plus the next one
+	m_PendingFullRedraws = m_RenderThread ? m_RenderQueueDepth + 2 : 1;
+}
+
+RenderStats Window::RenderFrame(ImDrawData* drawData)
+{
+	RenderStats stats;
+
+	const bool isOffscreen = m_IsDamageRenderingEnabled || m_IsHeadless;
+	if (!isOffscreen || GetGLContextVersion().m_Major < 3)
+	{
+		m_Framebuffer.reset();
+		m_LastDamageFraction = 1;
+		return RenderDrawData(drawData);
+	}
+
+	const auto fbWidth = uint32_t(drawData->DisplaySize.x * drawData->FramebufferScale.x);
+	const auto fbHeight = uint32_t(drawData->DisplaySize.y * drawData->FramebufferScale.y);
+	if (fbWidth == 0 || fbHeight == 0)
+		return stats;
+
+	if (!m_Framebuffer)
+		m_Framebuffer = std::make_unique<Framebuffer>();
+
+	std::optional<ImVec4> damage;
+	if (m_IsDamageRenderingEnabled)
+	{
+		if (!m_DamageTracker)
+			m_DamageTracker = std::make_unique<DamageTracker>();
+
+		damage = m_DamageTracker->Update(*drawData);
+	}
+
+	if (m_PendingFullRedraws.load() > 0)
+	{
+		m_PendingFullRedraws--;
+		damage.reset();
+	}
+
+	if (m_Framebuffer->Resize(fbWidth, fbHeight))
+		damage.reset();
+
+	m_Framebuffer->Bind();
+	glClearColor(0, 0, 0, 0);
+
+	if (!damage)
+	{
+		glDisable(GL_SCISSOR_TEST);
+		glClear(GL_COLOR_BUFFER_BIT);
+		stats = RenderDrawData(drawData);
+		m_LastDamageFraction = 1;
+	}
+	else if (damage->z > damage->x && damage->w > damage->y)
+	{
+		// Scissor is in framebuffer pixels, with y going up
+		const ImVec2 pos = drawData->DisplayPos;
+		const ImVec2 scale = drawData->FramebufferScale;
+		const auto x = GLint((damage->x - pos.x) * scale.x);
+		const auto y = GLint(fbHeight) - GLint((damage->w - pos.y) * scale.y);
+		const auto w = GLsizei((damage->z - damage->x) * scale.x);
+		const auto h = GLsizei((damage->w - damage->y) * scale.y);
+
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(x, y, w, h);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glDisable(GL_SCISSOR_TEST);
+
+		DamageTracker::ClipDrawData(*drawData, *damage);
+		stats = RenderDrawData(drawData);
+		m_LastDamageFraction = float(w) * float(h) / (float(fbWidth) * float(fbHeight));
+	}
+	else
+	{
+		m_LastDamageFraction = 0;
+	}
+
+	if (m_IsHeadless)
+		Framebuffer::BindDefault();
+	else
+		m_Framebuffer->BlitToDefault();
+
+	return stats;
+}
+
+RenderStats Window::RenderDrawData(ImDrawData* drawData)
+{
+	// m_RenderThreadBuffers only exists while the render thread does the rendering
+	if (m_Renderer)
+		return m_Renderer->RenderDrawData(*drawData, m_RenderThreadBuffers.get());
+
 #ifdef IMGUI_USE_OPENGL3
 	if (GetGLContextVersion().m_Major >= 3)
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		ImGui_ImplOpenGL3_RenderDrawData(drawData);
 	else
 #endif
-		ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
+		ImGui_ImplOpenGL2_RenderDrawData(drawData);
+
+	return {};
+}
+
+void Window::Present(GLContextScope& scope, int swapInterval)
+{
+	// Nowhere to present to, the frame stays in m_Framebuffer for ReadPixels()
+	if (m_IsHeadless)
+		return;
+
+	// Adaptive vsync needs EXT_swap_control_tear, present immediately if we don't have it
+	if (swapInterval == -1 && m_IsAdaptiveVSyncSupported && !scope.SetSwapInterval(-1))
+		m_IsAdaptiveVSyncSupported = false;
+	if (swapInterval != -1 || !m_IsAdaptiveVSyncSupported)
+		scope.SetSwapInterval(swapInterval == -1 ? 0 : swapInterval);
 
 	SDL_GL_SwapWindow(m_WindowImpl.get());
-	OnEndFrame();
 }
 
 void Window::CustomDeleters::operator()(SDL_Window* window) const
 {
+	GLContextScope::ReleaseWindow(window);
 	SDL_DestroyWindow(window);
 }
 
@@ -0,0 +1,145 @@
+// StateStore on its own, without an imgui context. Collisions are forced by picking IDs that land in
+// the same home slot, which is what the probing and backward shift deletion have to get right.
+
+#include "StateStore.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+using namespace ImGuiDesktop;
+
+#define CHECK(expr) \
+	do \
+	{ \
+		if (!(expr)) \
+		{ \
+			std::fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			std::exit(1); \
+		} \
+	} while (false)
+
+namespace
+{
+	// Same hash as the store, for the 64 slots it starts out with
+	uint32_t GetHomeSlot(ImGuiID id)
+	{
+		return (uint32_t(id) * 0x9E3779B1u) >> (32 - 6);
+	}
+
+	std::vector<ImGuiID> FindCollidingIDs(uint32_t homeSlot, size_t count)
+	{
+		std::vector<ImGuiID> ids;
+		for (ImGuiID id = 1; ids.size() < count; id++)
+		{
+			if (GetHomeSlot(id) == homeSlot)
+				ids.push_back(id);
+		}
+
+		return ids;
+	}
+
+	void TestInsertAndFind()
+	{
+		StateStore store;
+		CHECK(!store.Find<int>(1));
+		CHECK(store.Get<int>(1, 7) == 7);
+
+		*store.Insert<int>(1, 10) += 1;
+		store.Set<float>(2, 2.5f);
+		store.Set<int>(1, store.Get<int>(1) + 1);
+
+		CHECK(store.Get<int>(1) == 12);
+		CHECK(store.Get<float>(2) == 2.5f);
+		CHECK(!store.Find<int>(3));
+		CHECK(store.GetCount() == 2);
+	}
+
+	void TestCollisions()
+	{
+		StateStore store;
+		const std::vector<ImGuiID> ids = FindCollidingIDs(63, 5); // Last slot, so the run wraps around
+		for (size_t i = 0; i < ids.size(); i++)
+			store.Insert<int>(ids[i], int(i));
+
+		for (size_t i = 0; i < ids.size(); i++)
+			CHECK(store.Get<int>(ids[i], -1) == int(i));
+
+		// Out of the middle of the run, then its start. Everything after has to stay reachable.
+		CHECK(store.Erase(ids[2]));
+		CHECK(!store.Erase(ids[2]));
+		CHECK(!store.Find<int>(ids[2]));
+		CHECK(store.Erase(ids[0]));
+		CHECK(store.GetCount() == ids.size() - 2);
+
+		CHECK(store.Get<int>(ids[1], -1) == 1);
+		CHECK(store.Get<int>(ids[3], -1) == 3);
+		CHECK(store.Get<int>(ids[4], -1) == 4);
+
+		store.Insert<int>(ids[0], 100);
+		CHECK(store.Get<int>(ids[0], -1) == 100);
+		CHECK(store.GetCount() == ids.size() - 1);
+	}
+
+	// Growing rehashes the slots but must never move the values
+	void TestGrowth()
+	{
+		StateStore store;
+		std::vector<const uint64_t*> values;
+		for (ImGuiID id = 0; id < 5000; id++)
+			values.push_back(store.Insert<uint64_t>(id, uint64_t(id) * 3));
+
+		CHECK(store.GetCount() == 5000);
+		for (ImGuiID id = 0; id < 5000; id++)
+		{
+			CHECK(store.Find<uint64_t>(id) == values[id]);
+			CHECK(*values[id] == uint64_t(id) * 3);
+		}
+	}
+
+	// Lots of inserts and erases over a small range of IDs, so runs keep forming and breaking up
+	void TestAgainstUnorderedMap()
+	{
+		StateStore store;
+		std::unordered_map<ImGuiID, uint32_t> expected;
+
+		uint32_t random = 12345;
+		for (int step = 0; step < 100000; step++)
+		{
+			random = random * 1664525u + 1013904223u;
+			const ImGuiID id = (random >> 8) % 512;
+
+			if (random & 1)
+			{
+				store.Set<uint32_t>(id, random);
+				expected[id] = random;
+			}
+			else
+			{
+				CHECK(store.Erase(id) == (expected.erase(id) != 0));
+			}
+		}
+
+		CHECK(store.GetCount() == expected.size());
+		for (ImGuiID id = 0; id < 512; id++)
+		{
+			const auto it = expected.find(id);
+			const uint32_t* value = store.Find<uint32_t>(id);
+			CHECK((it != expected.end()) == (value != nullptr));
+			CHECK(!value || *value == it->second);
+		}
+	}
+}
+
+int main()
+{
+	TestInsertAndFind();
+	TestCollisions();
+	TestGrowth();
+	TestAgainstUnorderedMap();
+
+	std::puts("StateStore tests passed");
+	return 0;
+}
@@ -0,0 +1,163 @@
+// StreamBuffer against a fake GL that hands deleted buffer names straight back out, like real drivers do.
+// Doesn't need a context or a window.
+
+#include "StreamBuffer.h"
+
+#include <glad/gl.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+using namespace ImGuiDesktop;
+
+#define CHECK(expr) \
+	do \
+	{ \
+		if (!(expr)) \
+		{ \
+			std::fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			std::exit(1); \
+		} \
+	} while (false)
+
+namespace
+{
+	std::vector<GLuint> s_FreeNames;
+	GLuint s_NextName = 1;
+	std::vector<std::byte> s_Storage;
+	size_t s_LiveSyncs = 0;
+	bool s_FailNextMap = false;
+	bool s_IsMapped = false;
+
+	void GLAD_API_PTR FakeGenBuffers(GLsizei count, GLuint* buffers)
+	{
+		for (GLsizei i = 0; i < count; i++)
+		{
+			if (s_FreeNames.empty())
+			{
+				buffers[i] = s_NextName++;
+			}
+			else
+			{
+				buffers[i] = s_FreeNames.back();
+				s_FreeNames.pop_back();
+			}
+		}
+	}
+
+	void GLAD_API_PTR FakeDeleteBuffers(GLsizei count, const GLuint* buffers)
+	{
+		s_FreeNames.insert(s_FreeNames.end(), buffers, buffers + count);
+	}
+
+	void GLAD_API_PTR FakeBindBuffer(GLenum, GLuint) {}
+
+	void GLAD_API_PTR FakeBufferData(GLenum, GLsizeiptr size, const void*, GLenum)
+	{
+		s_Storage.assign(size_t(size), std::byte{});
+	}
+
+	void GLAD_API_PTR FakeBufferStorage(GLenum, GLsizeiptr size, const void*, GLbitfield)
+	{
+		s_Storage.assign(size_t(size), std::byte{});
+	}
+
+	void* GLAD_API_PTR FakeMapBufferRange(GLenum, GLintptr offset, GLsizeiptr, GLbitfield)
+	{
+		if (std::exchange(s_FailNextMap, false))
+			return nullptr;
+
+		s_IsMapped = true;
+		return s_Storage.data() + offset;
+	}
+
+	GLboolean GLAD_API_PTR FakeUnmapBuffer(GLenum)
+	{
+		// Unmapping a buffer that isn't mapped is GL_INVALID_OPERATION
+		CHECK(s_IsMapped);
+		s_IsMapped = false;
+		return GL_TRUE;
+	}
+
+	GLsync GLAD_API_PTR FakeFenceSync(GLenum, GLbitfield)
+	{
+		return reinterpret_cast<GLsync>(++s_LiveSyncs);
+	}
+
+	void GLAD_API_PTR FakeDeleteSync(GLsync)
+	{
+		s_LiveSyncs--;
+	}
+
+	GLenum GLAD_API_PTR FakeClientWaitSync(GLsync, GLbitfield, GLuint64)
+	{
+		return GL_ALREADY_SIGNALED;
+	}
+
+	void InstallFakeGL()
+	{
+		glad_glGenBuffers = &FakeGenBuffers;
+		glad_glDeleteBuffers = &FakeDeleteBuffers;
+		glad_glBindBuffer = &FakeBindBuffer;
+		glad_glBufferData = &FakeBufferData;
+		glad_glBufferStorage = &FakeBufferStorage;
+		glad_glMapBufferRange = &FakeMapBufferRange;
+		glad_glUnmapBuffer = &FakeUnmapBuffer;
+		glad_glFenceSync = &FakeFenceSync;
+		glad_glDeleteSync = &FakeDeleteSync;
+		glad_glClientWaitSync = &FakeClientWaitSync;
+	}
+
+	// Anything that remembers the buffer (like a VAO) has to look at the generation, the name comes back
+	void TestGrowReusingName(bool persistent)
+	{
+		StreamBuffer buffer(persistent, 1024);
+		const uint32_t name = buffer.GetBuffer();
+		const uint64_t generation = buffer.GetGeneration();
+
+		size_t offset;
+		CHECK(buffer.Map(512, 16, offset));
+		buffer.Unmap();
+		buffer.EndFrame();
+		CHECK(buffer.GetGeneration() == generation);
+
+		CHECK(buffer.Map(4096, 16, offset));
+		CHECK(buffer.GetCapacity() >= 4096);
+		CHECK(offset == 0);
+		CHECK(buffer.GetBuffer() == name);
+		CHECK(buffer.GetGeneration() != generation);
+		buffer.Unmap();
+		buffer.EndFrame();
+	}
+
+	// A failed Map() leaves nothing to unmap, and the next frame maps as usual
+	void TestMapFailure()
+	{
+		StreamBuffer buffer(false, 1024);
+
+		size_t offset;
+		s_FailNextMap = true;
+		CHECK(!buffer.Map(256, 16, offset));
+		buffer.EndFrame();
+
+		CHECK(buffer.Map(256, 16, offset));
+		CHECK(offset == 0);
+		buffer.Unmap();
+		buffer.EndFrame();
+	}
+}
+
+int main()
+{
+	InstallFakeGL();
+
+	TestGrowReusingName(false);
+	TestGrowReusingName(true);
+	TestMapFailure();
+	CHECK(s_LiveSyncs == 0);
+
+	std::puts("StreamBuffer tests passed");
+	return 0;
+}